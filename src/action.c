@@ -27,6 +27,7 @@
 #include "libalarm.h"
 #include "xutil.h"
 #include "serialize.h"
+#include "pool.h"
 
 /* ------------------------------------------------------------------------- *
  * alarm_action_ctor
@@ -72,7 +73,7 @@ alarm_action_dtor(alarm_action_t *self)
 alarm_action_t *
 alarm_action_create(void)
 {
-  alarm_action_t *self = calloc(1, sizeof *self);
+  alarm_action_t *self = pool_alloc(&pool_action[0]);
   alarm_action_ctor(self);
   return self;
 }
@@ -87,7 +88,7 @@ alarm_action_delete(alarm_action_t *self)
   if( self != 0 )
   {
     alarm_action_dtor(self);
-    free(self);
+    pool_release(&pool_action[0], self);
   }
 }
 
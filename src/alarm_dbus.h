@@ -162,6 +162,32 @@
  **/
 #define ALARMD_EVENT_QUERY "query_event"
 
+/**
+ * Queries the queue for matching events and
+ * returns the events instead of cookies.
+ *
+ * @since v1.1.24
+ *
+ * Uses the same filtering rules as #ALARMD_EVENT_QUERY.
+ * The matching events are in ascending trigger time
+ * order; offset and limit select a window from them.
+ * Getting less than limit events means that there are
+ * no more matches.
+ *
+ * @param start_time : INT32 [time_t]
+ * @param stop_time  : INT32 [time_t]
+ * @param flag_mask  : INT32
+ * @param flag_want  : INT32
+ * @param app_name   : STRING
+ * @param offset     : UINT32, number of matches to skip
+ * @param limit      : UINT32, max events to return, 0 = no limit
+ *
+ * @returns count  : UINT32
+ * <br>    events : 'count' events, each encoded as
+ *                  for #ALARMD_EVENT_GET
+ **/
+#define ALARMD_EVENT_QUERY_FULL "query_events_full"
+
 /**
  * Updates an existing event.
  *
@@ -203,6 +229,51 @@
  **/
 #define ALARMD_EVENT_UPDATE "update_event"
 
+/**
+ * Adds several events to the queue.
+ *
+ * @since v1.1.24
+ *
+ * All events are decoded before any of them is added,
+ * and the queue is re-evaluated only once.
+ *
+ * @param count          : UINT32
+ * @param events         : 'count' events, each encoded as
+ *                         for #ALARMD_EVENT_ADD, including
+ *                         the attribute table
+ *
+ * @returns cookies : ARRAY of INT32, 0 = event not added
+ **/
+#define ALARMD_EVENTS_ADD "add_events"
+
+/**
+ * Updates several existing events.
+ *
+ * @since v1.1.24
+ *
+ * Performs #ALARMD_EVENT_UPDATE for each event,
+ * but re-evaluates the queue only once.
+ *
+ * @param count          : UINT32
+ * @param events         : 'count' events, each encoded as
+ *                         for #ALARMD_EVENT_UPDATE, including
+ *                         the attribute table
+ *
+ * @returns cookies : ARRAY of INT32, 0 = event not added
+ **/
+#define ALARMD_EVENTS_UPDATE "update_events"
+
+/**
+ * Removes several events from the queue.
+ *
+ * @since v1.1.24
+ *
+ * @param cookies : ARRAY of INT32
+ *
+ * @returns deleted : INT32, number of events removed
+ **/
+#define ALARMD_EVENTS_DEL "del_events"
+
 /**
  * Set default snooze time in seconds.
  *
@@ -221,6 +292,35 @@
  **/
 #define ALARMD_SNOOZE_GET "get_snooze"
 
+/**
+ * Get queue statistics for monitoring purposes.
+ *
+ * @since v1.1.24
+ *
+ * Nearest trigger times are INT_MAX if there are
+ * no events in the boot class. State and flag counts
+ * include only enabled events, application counts
+ * include all events in the queue.
+ *
+ * @returns events    : UINT32, number of events in queue
+ * <br>    bytes     : UINT32, size of queue file and journal
+ * <br>    desktop   : INT32 [time_t], nearest boot to desktop alarm
+ * <br>    actdead   : INT32 [time_t], nearest boot to acting dead alarm
+ * <br>    noboot    : INT32 [time_t], nearest non booting alarm
+ * <br>    rethinks  : UINT32, queue evaluation passes
+ * <br>    saved     : UINT32, full queue file writes
+ * <br>    journaled : UINT32, journal appends
+ * <br>    skipped   : UINT32, saves with nothing to write
+ * <br>    failed    : UINT32, failed saves
+ * <br>    states    : UINT32, followed by 'states' pairs of
+ *                     STRING state name, UINT32 count
+ * <br>    flags     : UINT32, followed by 'flags' UINT32 counts
+ *                     of events with flag bit 0, 1, ... set
+ * <br>    apps      : UINT32, followed by 'apps' pairs of
+ *                     STRING alarm_appid, UINT32 count
+ **/
+#define ALARMD_QUEUE_STATS "get_queue_stats"
+
 /*@}*/
 
 /** @name DBus methods for SystemUI
@@ -2837,11 +2837,19 @@ alarmclient_handle_list_events(int verbose)
   cookie_t       *cookie = 0;
   alarm_event_t **event  = 0;
 
-  cookie = alarmd_event_query(0,0,0,0,0);
-
   size_t n;
 
-  for( n = 0; cookie && cookie[n]; ++n ) {}
+  if( verbose == 0 )
+  {
+    cookie = alarmd_event_query(0,0,0,0,0);
+    for( n = 0; cookie && cookie[n]; ++n ) {}
+  }
+  else
+  {
+    /* fetch all events in one round trip instead of query + N x get */
+    event = alarmd_event_query_full(0,0,0,0,0, 0,0);
+    for( n = 0; event && event[n]; ++n ) {}
+  }
 
   if( n == 0 )
   {
@@ -2856,12 +2864,6 @@ alarmclient_handle_list_events(int verbose)
   }
   else
   {
-    event = calloc(n, sizeof *event);
-    for( size_t i = 0; i < n; ++i )
-    {
-      event[i] = alarmd_event_get(cookie[i]);
-    }
-
     if( verbose == 1 )
     {
       time_t now = ticker_get_time();
@@ -2885,24 +2887,25 @@ alarmclient_handle_list_events(int verbose)
 
         snprintf(stamp, sizeof stamp, "%s (T%s)", date, secs);
 
-        alarmclient_emitf("[%03d] %-36s %s\n", cookie[i], stamp, ident);
+        alarmclient_emitf("[%03d] %-36s %s\n",
+                          (int)alarm_event_get_cookie(event[i]), stamp, ident);
       }
     }
     else
     {
       for( size_t i = 0; i < n; ++i )
       {
-        alarmclient_emitf("[%03d]  ", cookie[i]);
+        alarmclient_emitf("[%03d]  ", (int)alarm_event_get_cookie(event[i]));
         alarmclient_event_show(event[i]);
       }
     }
-    for( size_t i = 0; i < n; ++i )
-    {
-      alarm_event_delete(event[i]);
-    }
-    free(event);
   }
 
+  for( size_t i = 0; i < n && event; ++i )
+  {
+    alarm_event_delete(event[i]);
+  }
+  free(event);
   free(cookie);
 }
 
@@ -49,6 +49,7 @@ static const char *LGPL =
 #include "mainloop.h"
 #include "server.h"
 #include "xutil.h"
+#include "pool.h"
 
 #include <glib-object.h>
 
@@ -292,6 +293,16 @@ main(int argc, char **argv)
     log_level  = LOG_DEBUG;
   }
 
+  // the queue writer thread schedules idle callbacks from
+  // outside the mainloop thread; older glib needs thread
+  // support enabled before any other glib call
+#if !GLIB_CHECK_VERSION(2,32,0)
+  if( !g_thread_supported() )
+  {
+    g_thread_init(0);
+  }
+#endif
+
   // libconic uses gobjects
 #if !GLIB_CHECK_VERSION(2,35,0)
   g_type_init();
@@ -379,9 +390,17 @@ main(int argc, char **argv)
   log_set_level(log_level);
   log_open("alarmd", log_driver, 1);
 
+  /* recycle event, action, recurrence and attribute
+   * memory instead of going to heap for every request */
+  pool_enable(POOL_LIMIT_DEFAULT);
+
   log_info("-- startup --\n");
   int xc = mainloop_run();
   log_info("-- exit %d --\n", xc);
+
+  pool_log_stats();
+  pool_disable();
+
   log_close();
   return xc;
 }
@@ -44,6 +44,15 @@ extern "C" {
  * here.
  * ------------------------------------------------------------------------- */
 
+/* If non-zero, alarmd watches the cache directory and merges changes
+ * made to the queue file by somebody else into the live queue as soon
+ * as they are seen: events that were added, changed or removed in the
+ * file are added, replaced or deleted, others are left as they are.
+ *
+ * The restart / ignore handling below is then not used.
+ */
+#define ALARMD_QUEUE_MODIFIED_MERGE 1
+
 /* If non-zero, alarmd will give osso-backup some time to restart
  * alarmd. If that does not happen, alarmd will self terminate and
  * then gets restarted by dsme process lifeguard.
@@ -51,7 +60,7 @@ extern "C" {
  * This is the documented behavior, but odd things may happen if
  * somebody else than osso-restore modifies the queue file.
  */
-#if FIX_BUG_141279
+#if FIX_BUG_141279 || ALARMD_QUEUE_MODIFIED_MERGE
 # define ALARMD_QUEUE_MODIFIED_RESTART 0
 #else
 # define ALARMD_QUEUE_MODIFIED_RESTART 1
@@ -65,7 +74,7 @@ extern "C" {
  * to the queue file unless followed by alarmd restart that is normally
  * part of restore process.
  */
-#if FIX_BUG_141279
+#if FIX_BUG_141279 && !ALARMD_QUEUE_MODIFIED_MERGE
 # define ALARMD_QUEUE_MODIFIED_IGNORE  1
 #else
 # define ALARMD_QUEUE_MODIFIED_IGNORE  0
@@ -0,0 +1,169 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+
+#include "alarmd_config.h"
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* default size of arena blocks, larger requests get a block of their own */
+#define ARENA_BLOCK_SIZE (32 << 10)
+
+/* alignment used for arena_alloc() */
+#define ARENA_ALIGN 8
+
+/* ------------------------------------------------------------------------- *
+ * arena_blk_t
+ * ------------------------------------------------------------------------- */
+
+struct arena_blk_t
+{
+  arena_blk_t *ab_next;
+  size_t       ab_size;
+  size_t       ab_used;
+  char         ab_data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+/* ========================================================================= *
+ * arena_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * arena_take  --  get memory from current block, start a new one if needed
+ * ------------------------------------------------------------------------- */
+
+static
+void *
+arena_take(arena_t *self, size_t size, size_t align)
+{
+  arena_blk_t *blk = self->ar_block;
+  size_t       pos = 0;
+
+  if( blk != 0 )
+  {
+    pos = (blk->ab_used + align - 1) & ~(align - 1);
+  }
+
+  if( blk == 0 || pos + size > blk->ab_size )
+  {
+    size_t need = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+
+    blk = malloc(sizeof *blk + need);
+    blk->ab_size = need;
+    blk->ab_used = 0;
+
+    /* oversized blocks go behind the current one so
+     * that the space left in it is not wasted */
+    if( size > ARENA_BLOCK_SIZE && self->ar_block != 0 )
+    {
+      blk->ab_next = self->ar_block->ab_next;
+      self->ar_block->ab_next = blk;
+    }
+    else
+    {
+      blk->ab_next   = self->ar_block;
+      self->ar_block = blk;
+    }
+
+    self->ar_blocks += 1;
+    self->ar_size   += need;
+    pos = 0;
+  }
+
+  blk->ab_used   = pos + size;
+  self->ar_used += size;
+
+  return blk->ab_data + pos;
+}
+
+/* ------------------------------------------------------------------------- *
+ * arena_alloc
+ * ------------------------------------------------------------------------- */
+
+void *
+arena_alloc(arena_t *self, size_t size)
+{
+  return arena_take(self, size, ARENA_ALIGN);
+}
+
+/* ------------------------------------------------------------------------- *
+ * arena_calloc
+ * ------------------------------------------------------------------------- */
+
+void *
+arena_calloc(arena_t *self, size_t size)
+{
+  return memset(arena_take(self, size, ARENA_ALIGN), 0, size);
+}
+
+/* ------------------------------------------------------------------------- *
+ * arena_memdup
+ * ------------------------------------------------------------------------- */
+
+void *
+arena_memdup(arena_t *self, const void *data, size_t size)
+{
+  return memcpy(arena_take(self, size, 1), data, size);
+}
+
+/* ------------------------------------------------------------------------- *
+ * arena_strdup
+ * ------------------------------------------------------------------------- */
+
+char *
+arena_strdup(arena_t *self, const char *str)
+{
+  return arena_memdup(self, str, strlen(str) + 1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * arena_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+arena_ctor(arena_t *self)
+{
+  self->ar_block  = 0;
+  self->ar_blocks = 0;
+  self->ar_size   = 0;
+  self->ar_used   = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * arena_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+arena_dtor(arena_t *self)
+{
+  for( arena_blk_t *blk; (blk = self->ar_block) != 0; )
+  {
+    self->ar_block = blk->ab_next;
+    free(blk);
+  }
+  arena_ctor(self);
+}
@@ -0,0 +1,67 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#elif 0
+} /* fool JED indentation ... */
+#endif
+
+typedef struct arena_t     arena_t;
+typedef struct arena_blk_t arena_blk_t;
+
+/* ------------------------------------------------------------------------- *
+ * arena_t
+ * ------------------------------------------------------------------------- */
+
+/* Bump pointer allocator: memory is handed out from large blocks
+ * and can not be released piecemeal, everything is freed at once
+ * when the arena is destroyed. */
+
+struct arena_t
+{
+  arena_blk_t *ar_block;   // most recently allocated block
+  size_t       ar_blocks;  // number of blocks
+  size_t       ar_size;    // bytes in blocks
+  size_t       ar_used;    // bytes handed out
+};
+
+void      arena_ctor    (arena_t *self);
+void      arena_dtor    (arena_t *self);
+void     *arena_alloc   (arena_t *self, size_t size);
+void     *arena_calloc  (arena_t *self, size_t size);
+char     *arena_strdup  (arena_t *self, const char *str);
+void     *arena_memdup  (arena_t *self, const void *data, size_t size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* ARENA_H_ */
@@ -26,6 +26,7 @@
 
 #include "libalarm.h"
 #include "xutil.h"
+#include "pool.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -172,7 +173,7 @@ time_t alarm_attr_get_time(alarm_attr_t *self)
 alarm_attr_t *
 alarm_attr_create(const char *name)
 {
-  alarm_attr_t *self = calloc(1, sizeof *self);
+  alarm_attr_t *self = pool_alloc(&pool_attr);
   alarm_attr_ctor(self);
   xstrset(&self->attr_name, name);
   return self;
@@ -188,7 +189,7 @@ alarm_attr_delete(alarm_attr_t *self)
   if( self != 0 )
   {
     alarm_attr_dtor(self);
-    free(self);
+    pool_release(&pool_attr, self);
   }
 }
 
@@ -516,6 +516,198 @@ alarmd_event_del(cookie_t cookie)
   return res;
 }
 
+/* ------------------------------------------------------------------------- *
+ * alarmd_event_add_many & alarmd_event_update_many
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+client_make_events_message(const char *method,
+                           alarm_event_t * const *events, int count)
+{
+  DBusMessage *msg = 0;
+
+  for( int i = 0; i < count; ++i )
+  {
+    if( alarm_event_is_sane(events[i]) == -1 )
+    {
+      goto cleanup;
+    }
+  }
+
+  if( (msg = client_make_method_message(method, DBUS_TYPE_INVALID)) )
+  {
+    if( !dbusif_encode_events(msg, events, count) )
+    {
+      dbus_message_unref(msg), msg = 0;
+    }
+  }
+
+  cleanup:
+
+  return msg;
+}
+
+static
+int
+client_parse_events_reply(DBusMessage *rsp, cookie_t *cookies, int count)
+{
+  int           res = -1;
+  dbus_int32_t *vec = 0;
+  int           cnt = 0;
+  DBusError     err = DBUS_ERROR_INIT;
+
+  if( client_parse_reply(rsp, &err,
+                         DBUS_TYPE_ARRAY, DBUS_TYPE_INT32, &vec, &cnt,
+                         DBUS_TYPE_INVALID) )
+  {
+    if( cnt == count )
+    {
+      for( int i = 0; i < cnt; ++i )
+      {
+        cookies[i] = vec[i];
+      }
+      res = 0;
+    }
+    else
+    {
+      log_error_F("got %d cookies for %d events\n", cnt, count);
+    }
+  }
+
+  if( dbus_error_is_set(&err) )
+  {
+    log_error_F("%s: %s\n", err.name, err.message);
+  }
+
+  dbus_error_free(&err);
+
+  return res;
+}
+
+DBusMessage *
+alarmd_event_add_many_encode_req(alarm_event_t * const *events, int count)
+{
+  return client_make_events_message(ALARMD_EVENTS_ADD, events, count);
+}
+
+int
+alarmd_event_add_many_decode_rsp(DBusMessage *rsp, cookie_t *cookies, int count)
+{
+  return client_parse_events_reply(rsp, cookies, count);
+}
+
+int
+alarmd_event_add_many(alarm_event_t * const *events, int count, cookie_t *cookies)
+{
+  int            res = -1;
+  DBusMessage   *msg = 0;
+  DBusMessage   *rsp = 0;
+
+  if( (msg = alarmd_event_add_many_encode_req(events, count)) )
+  {
+    if( client_exec_method_call(msg, &rsp) != -1 )
+    {
+      res = alarmd_event_add_many_decode_rsp(rsp, cookies, count);
+    }
+  }
+
+  if( rsp != 0 ) dbus_message_unref(rsp);
+  if( msg != 0 ) dbus_message_unref(msg);
+
+  return res;
+}
+
+DBusMessage *
+alarmd_event_update_many_encode_req(alarm_event_t * const *events, int count)
+{
+  return client_make_events_message(ALARMD_EVENTS_UPDATE, events, count);
+}
+
+int
+alarmd_event_update_many_decode_rsp(DBusMessage *rsp, cookie_t *cookies, int count)
+{
+  return client_parse_events_reply(rsp, cookies, count);
+}
+
+int
+alarmd_event_update_many(alarm_event_t * const *events, int count, cookie_t *cookies)
+{
+  int            res = -1;
+  DBusMessage   *msg = 0;
+  DBusMessage   *rsp = 0;
+
+  if( (msg = alarmd_event_update_many_encode_req(events, count)) )
+  {
+    if( client_exec_method_call(msg, &rsp) != -1 )
+    {
+      res = alarmd_event_update_many_decode_rsp(rsp, cookies, count);
+    }
+  }
+
+  if( rsp != 0 ) dbus_message_unref(rsp);
+  if( msg != 0 ) dbus_message_unref(msg);
+
+  return res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * alarmd_event_del_many
+ * ------------------------------------------------------------------------- */
+
+DBusMessage *
+alarmd_event_del_many_encode_req(const cookie_t *cookies, int count)
+{
+  return client_make_method_message(ALARMD_EVENTS_DEL,
+                                    DBUS_TYPE_ARRAY,
+                                    DBUS_TYPE_INT32, &cookies, count,
+                                    DBUS_TYPE_INVALID);
+}
+
+int
+alarmd_event_del_many_decode_rsp(DBusMessage *rsp)
+{
+  int          res = -1;
+  DBusError    err = DBUS_ERROR_INIT;
+  dbus_int32_t cnt = 0;
+
+  if( client_parse_reply(rsp, &err,
+                         DBUS_TYPE_INT32, &cnt,
+                         DBUS_TYPE_INVALID) )
+  {
+    res = cnt;
+  }
+  if( dbus_error_is_set(&err) )
+  {
+    log_error_F("%s: %s\n", err.name, err.message);
+  }
+
+  dbus_error_free(&err);
+
+  return res;
+}
+
+int
+alarmd_event_del_many(const cookie_t *cookies, int count)
+{
+  int            res = -1;
+  DBusMessage   *msg = 0;
+  DBusMessage   *rsp = 0;
+
+  if( (msg = alarmd_event_del_many_encode_req(cookies, count)) )
+  {
+    if( client_exec_method_call(msg, &rsp) != -1 )
+    {
+      res = alarmd_event_del_many_decode_rsp(rsp);
+    }
+  }
+
+  if( rsp != 0 ) dbus_message_unref(rsp);
+  if( msg != 0 ) dbus_message_unref(msg);
+
+  return res;
+}
+
 /* ------------------------------------------------------------------------- *
  * alarmd_event_query
  * ------------------------------------------------------------------------- */
@@ -596,6 +788,89 @@ alarmd_event_query(const time_t first, const time_t last,
   return res;
 }
 
+/* ------------------------------------------------------------------------- *
+ * alarmd_event_query_full
+ * ------------------------------------------------------------------------- */
+
+DBusMessage *
+alarmd_event_query_full_encode_req(const time_t first, const time_t last,
+                                   int32_t flag_mask, int32_t flags,
+                                   const char *appid,
+                                   unsigned offset, unsigned limit)
+{
+  dbus_int32_t  lo  = first;
+  dbus_int32_t  hi  = last;
+  dbus_int32_t  msk = flag_mask;
+  dbus_int32_t  flg = flags;
+  dbus_uint32_t ofs = offset;
+  dbus_uint32_t lim = limit;
+
+  if( appid == 0 )
+  {
+    appid = "";
+  }
+
+  return client_make_method_message(ALARMD_EVENT_QUERY_FULL,
+                                    DBUS_TYPE_INT32,  &lo,
+                                    DBUS_TYPE_INT32,  &hi,
+                                    DBUS_TYPE_INT32,  &msk,
+                                    DBUS_TYPE_INT32,  &flg,
+                                    DBUS_TYPE_STRING, &appid,
+                                    DBUS_TYPE_UINT32, &ofs,
+                                    DBUS_TYPE_UINT32, &lim,
+                                    DBUS_TYPE_INVALID);
+}
+
+alarm_event_t **
+alarmd_event_query_full_decode_rsp(DBusMessage *rsp)
+{
+  alarm_event_t **res = 0;
+  int             cnt = 0;
+
+  if( dbus_message_get_type(rsp) == DBUS_MESSAGE_TYPE_ERROR )
+  {
+    // get error from error reply
+    DBusError   err  = DBUS_ERROR_INIT;
+    const char *name = dbus_message_get_error_name(rsp) ?: "noname";
+    const char *mesg = "nomesg";
+    dbus_message_get_args(rsp, &err,
+                          DBUS_TYPE_STRING, &mesg,
+                          DBUS_TYPE_INVALID);
+    log_error_F("%s: %s\n", name, mesg);
+    dbus_error_free(&err);
+  }
+  else
+  {
+    res = dbusif_decode_events(rsp, &cnt);
+  }
+  return res;
+}
+
+alarm_event_t **
+alarmd_event_query_full(const time_t first, const time_t last,
+                        int32_t flag_mask, int32_t flags, const char *appid,
+                        unsigned offset, unsigned limit)
+{
+  alarm_event_t **res = 0;
+  DBusMessage    *msg = 0;
+  DBusMessage    *rsp = 0;
+
+  if( (msg = alarmd_event_query_full_encode_req(first, last,
+                                                flag_mask, flags, appid,
+                                                offset, limit)) )
+  {
+    if( client_exec_method_call(msg, &rsp) != -1 )
+    {
+      res = alarmd_event_query_full_decode_rsp(rsp);
+    }
+  }
+
+  if( rsp != 0 ) dbus_message_unref(rsp);
+  if( msg != 0 ) dbus_message_unref(msg);
+
+  return res;
+}
+
 /* ------------------------------------------------------------------------- *
  * alarmd_get_default_snooze
  * ------------------------------------------------------------------------- */
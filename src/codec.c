@@ -249,6 +249,17 @@ decode_dstring(DBusMessageIter *iter, int *err, char **pval)
   *pval = strdup(tmp ?: "");
 }
 
+/* Borrowed strings point to the message that is being decoded
+ * and are valid only as long as the message is. */
+
+void
+decode_bstring(DBusMessageIter *iter, int *err, char **pval)
+{
+  const char *tmp = 0;
+  decode_string(iter, err, &tmp);
+  *pval = (char *)tmp;
+}
+
 void
 encode_size(DBusMessageIter *iter, int *err, const size_t *pval)
 {
@@ -344,17 +355,28 @@ encode_action(DBusMessageIter *iter, int *err, const alarm_action_t *act,
   //encode_string   (iter, err, &act->dbus_args);
 }
 
+static
 void
-decode_action(DBusMessageIter *iter, int *err, alarm_action_t *act)
+decode_action_ex(DBusMessageIter *iter, int *err, alarm_action_t *act,
+                 int borrow)
 {
+  void (*decode_str)(DBusMessageIter *, int *, char **) =
+    borrow ? decode_bstring : decode_dstring;
+
   decode_unsigned (iter, err, &act->flags);
-  decode_dstring  (iter, err, &act->label);
-  decode_dstring  (iter, err, &act->exec_command);
-  decode_dstring  (iter, err, &act->dbus_interface);
-  decode_dstring  (iter, err, &act->dbus_service);
-  decode_dstring  (iter, err, &act->dbus_path);
-  decode_dstring  (iter, err, &act->dbus_name);
-  decode_dstring  (iter, err, &act->dbus_args);
+  decode_str      (iter, err, &act->label);
+  decode_str      (iter, err, &act->exec_command);
+  decode_str      (iter, err, &act->dbus_interface);
+  decode_str      (iter, err, &act->dbus_service);
+  decode_str      (iter, err, &act->dbus_path);
+  decode_str      (iter, err, &act->dbus_name);
+  decode_str      (iter, err, &act->dbus_args);
+}
+
+void
+decode_action(DBusMessageIter *iter, int *err, alarm_action_t *act)
+{
+  decode_action_ex(iter, err, act, 0);
 }
 
 void
@@ -464,26 +486,31 @@ decode_eom_p(DBusMessageIter *iter, int *err)
   return 0;
 }
 
+static
 void
-decode_event(DBusMessageIter *iter, int *err, alarm_event_t *eve)
+decode_event_ex(DBusMessageIter *iter, int *err, alarm_event_t *eve,
+                int borrow)
 {
   size_t action_cnt     = 0;
   size_t recurrence_cnt = 0;
 
+  void (*decode_str)(DBusMessageIter *, int *, char **) =
+    borrow ? decode_bstring : decode_dstring;
+
   alarm_event_del_actions(eve);
   alarm_event_del_recurrences(eve);
 
   decode_cookie   (iter, err, &eve->ALARMD_PRIVATE(cookie));
   decode_time     (iter, err, &eve->ALARMD_PRIVATE(trigger));
-  decode_dstring  (iter, err, &eve->title);
-  decode_dstring  (iter, err, &eve->message);
-  decode_dstring  (iter, err, &eve->sound);
-  decode_dstring  (iter, err, &eve->icon);
+  decode_str      (iter, err, &eve->title);
+  decode_str      (iter, err, &eve->message);
+  decode_str      (iter, err, &eve->sound);
+  decode_str      (iter, err, &eve->icon);
   decode_unsigned (iter, err, &eve->flags);
-  decode_dstring  (iter, err, &eve->alarm_appid);
+  decode_str      (iter, err, &eve->alarm_appid);
   decode_time     (iter, err, &eve->alarm_time);
   decode_tm       (iter, err, &eve->alarm_tm);
-  decode_dstring  (iter, err, &eve->alarm_tz);
+  decode_str      (iter, err, &eve->alarm_tz);
   decode_time     (iter, err, &eve->recur_secs);
   decode_int      (iter, err, &eve->recur_count);
   decode_time     (iter, err, &eve->snooze_secs);
@@ -499,7 +526,7 @@ decode_event(DBusMessageIter *iter, int *err, alarm_event_t *eve)
   alarm_action_t *act = alarm_event_add_actions(eve, action_cnt);
   for( size_t i = 0; i < action_cnt; ++i )
   {
-    decode_action(iter, err, &act[i]);
+    decode_action_ex(iter, err, &act[i], borrow);
   }
 
   /* - - - - - - - - - - - - - - - - - - - *
@@ -522,8 +549,88 @@ decode_event(DBusMessageIter *iter, int *err, alarm_event_t *eve)
     decode_size     (iter, err, &count);
     for( size_t i = 0; i < count; ++i )
     {
-      alarm_attr_t *att = alarm_event_add_attr(eve, "\x7f");
-      decode_attr(iter, err, att);
+      /* decode first, the table is kept sorted by name */
+      alarm_attr_t tmp, *att;
+
+      alarm_attr_ctor(&tmp);
+      decode_attr(iter, err, &tmp);
+
+      att = alarm_event_add_attr(eve, tmp.attr_name);
+      alarm_attr_set_null(att);
+      att->attr_type = tmp.attr_type;
+      att->attr_data = tmp.attr_data;
+
+      tmp.attr_type = ALARM_ATTR_NULL;
+      alarm_attr_dtor(&tmp);
     }
   }
 }
+
+void
+decode_event(DBusMessageIter *iter, int *err, alarm_event_t *eve)
+{
+  decode_event_ex(iter, err, eve, 0);
+}
+
+/* Event and action strings of events decoded with
+ * decode_event_borrowed() point to the message. Before the
+ * message is released they must be either copied with
+ * decode_event_adopt() or dropped with decode_event_abandon().
+ * Attributes are always copied. */
+
+static
+void
+decode_event_borrowed_strings(alarm_event_t *eve, void (*fn)(char **))
+{
+  fn(&eve->title);
+  fn(&eve->message);
+  fn(&eve->sound);
+  fn(&eve->icon);
+  fn(&eve->alarm_appid);
+  fn(&eve->alarm_tz);
+
+  for( size_t i = 0; i < eve->action_cnt; ++i )
+  {
+    alarm_action_t *act = &eve->action_tab[i];
+
+    fn(&act->label);
+    fn(&act->exec_command);
+    fn(&act->dbus_interface);
+    fn(&act->dbus_service);
+    fn(&act->dbus_path);
+    fn(&act->dbus_name);
+    fn(&act->dbus_args);
+  }
+}
+
+void
+decode_event_borrowed(DBusMessageIter *iter, int *err, alarm_event_t *eve)
+{
+  decode_event_ex(iter, err, eve, 1);
+}
+
+void
+decode_event_adopt(alarm_event_t *eve)
+{
+  auto void copy(char **pstr);
+
+  auto void copy(char **pstr)
+  {
+    *pstr = strdup(*pstr ?: "");
+  }
+
+  decode_event_borrowed_strings(eve, copy);
+}
+
+void
+decode_event_abandon(alarm_event_t *eve)
+{
+  auto void drop(char **pstr);
+
+  auto void drop(char **pstr)
+  {
+    *pstr = 0;
+  }
+
+  decode_event_borrowed_strings(eve, drop);
+}
@@ -60,6 +60,7 @@ void decode_unsigned(DBusMessageIter *iter, int *err, unsigned *pval);
 void decode_int     (DBusMessageIter *iter, int *err, int *pval);
 void decode_string  (DBusMessageIter *iter, int *err, const char **pval);
 void decode_dstring (DBusMessageIter *iter, int *err, char **pval);
+void decode_bstring (DBusMessageIter *iter, int *err, char **pval);
 void decode_size    (DBusMessageIter *iter, int *err, size_t *pval);
 void decode_cookie  (DBusMessageIter *iter, int *err, cookie_t *pval);
 void decode_time    (DBusMessageIter *iter, int *err, time_t *pval);
@@ -71,6 +72,11 @@ void decode_uint64  (DBusMessageIter *iter, int *err, uint64_t *pval);
 void decode_recur   (DBusMessageIter *iter, int *err, alarm_recur_t *rec);
 void decode_attr    (DBusMessageIter *iter, int *err, alarm_attr_t *rec);
 
+/* -- borrowed strings -- */
+void decode_event_borrowed(DBusMessageIter *iter, int *err, alarm_event_t *eve);
+void decode_event_adopt   (alarm_event_t *eve);
+void decode_event_abandon (alarm_event_t *eve);
+
 # ifdef __cplusplus
 };
 # endif
@@ -288,27 +288,172 @@ dbusif_encode_event(DBusMessage *msg, const alarm_event_t *eve, const char *args
 }
 
 /* ------------------------------------------------------------------------- *
- * dbusif_decode_event
+ * dbusif_decode_event_ex
  * ------------------------------------------------------------------------- */
 
+static
 alarm_event_t *
-dbusif_decode_event(DBusMessage *msg)
+dbusif_decode_event_ex(DBusMessage *msg, int borrow)
 {
   alarm_event_t  *eve = alarm_event_create();
   int             err = 0;
   DBusMessageIter iter;
 
   dbus_message_iter_init(msg, &iter);
-  decode_event(&iter, &err, eve);
+
+  if( borrow )
+  {
+    decode_event_borrowed(&iter, &err, eve);
+  }
+  else
+  {
+    decode_event(&iter, &err, eve);
+  }
 
   if( err != 0 )
   {
+    if( borrow ) decode_event_abandon(eve);
     alarm_event_delete(eve), eve = 0;
   }
 
   return eve;
 }
 
+/* ------------------------------------------------------------------------- *
+ * dbusif_decode_event
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t *
+dbusif_decode_event(DBusMessage *msg)
+{
+  return dbusif_decode_event_ex(msg, 0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * dbusif_decode_event_borrowed  --  decode without copying strings
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t *
+dbusif_decode_event_borrowed(DBusMessage *msg)
+{
+  return dbusif_decode_event_ex(msg, 1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * dbusif_encode_events
+ * ------------------------------------------------------------------------- */
+
+dbus_bool_t
+dbusif_encode_events(DBusMessage *msg, alarm_event_t * const *eve, int cnt)
+{
+  int       err = 0;
+  uint32_t  num = cnt;
+
+  DBusMessageIter iter;
+
+  dbus_message_iter_init_append(msg, &iter);
+
+  encode_uint32(&iter, &err, &num);
+
+  for( int i = 0; i < cnt; ++i )
+  {
+    const char *args = 0;
+    encode_event(&iter, &err, eve[i], &args);
+  }
+
+  return (err == 0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * dbusif_decode_events_ex  --  decode events to null terminated array
+ * ------------------------------------------------------------------------- */
+
+static
+alarm_event_t **
+dbusif_decode_events_ex(DBusMessage *msg, int *pcnt, int borrow)
+{
+  alarm_event_t **vec = 0;
+  uint32_t        num = 0;
+  int             cnt = 0;
+  int             err = 0;
+  DBusMessageIter iter;
+
+  dbus_message_iter_init(msg, &iter);
+  decode_uint32(&iter, &err, &num);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the count comes from the client, grow
+   * the table as events are decoded instead
+   * of trusting it for allocation size
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t alloc = 0; err == 0 && (uint32_t)cnt < num; ++cnt )
+  {
+    if( (size_t)cnt + 1 >= alloc )
+    {
+      alloc = alloc ? (alloc * 2) : 32;
+      vec = realloc(vec, alloc * sizeof *vec);
+    }
+    vec[cnt] = alarm_event_create();
+
+    if( borrow )
+    {
+      decode_event_borrowed(&iter, &err, vec[cnt]);
+    }
+    else
+    {
+      decode_event(&iter, &err, vec[cnt]);
+    }
+  }
+
+  if( err == 0 && dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_INVALID )
+  {
+    log_error_F("extra data after %d events\n", cnt);
+    err = -1;
+  }
+
+  if( err != 0 )
+  {
+    for( int i = 0; i < cnt; ++i )
+    {
+      if( borrow ) decode_event_abandon(vec[i]);
+      alarm_event_delete(vec[i]);
+    }
+    free(vec), vec = 0, cnt = 0;
+  }
+  else if( vec == 0 )
+  {
+    vec = calloc(1, sizeof *vec);
+  }
+  else
+  {
+    vec[cnt] = 0;
+  }
+
+  *pcnt = cnt;
+  return vec;
+}
+
+/* ------------------------------------------------------------------------- *
+ * dbusif_decode_events
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t **
+dbusif_decode_events(DBusMessage *msg, int *pcnt)
+{
+  return dbusif_decode_events_ex(msg, pcnt, 0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * dbusif_decode_events_borrowed  --  decode without copying strings
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t **
+dbusif_decode_events_borrowed(DBusMessage *msg, int *pcnt)
+{
+  return dbusif_decode_events_ex(msg, pcnt, 1);
+}
+
 /* ========================================================================= *
  * GENERIC DBUS HELPERS
  * ========================================================================= */
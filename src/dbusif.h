@@ -45,6 +45,10 @@ const char    *dbusif_get_dtatype_name (int typecode);
 void           dbusif_emit_message     (DBusMessage *msg);
 dbus_bool_t    dbusif_encode_event     (DBusMessage *msg, const alarm_event_t *eve, const char *args);
 alarm_event_t *dbusif_decode_event     (DBusMessage *msg);
+dbus_bool_t    dbusif_encode_events    (DBusMessage *msg, alarm_event_t * const *eve, int cnt);
+alarm_event_t **dbusif_decode_events   (DBusMessage *msg, int *pcnt);
+alarm_event_t *dbusif_decode_event_borrowed (DBusMessage *msg);
+alarm_event_t **dbusif_decode_events_borrowed(DBusMessage *msg, int *pcnt);
 int            dbusif_check_name_owner (DBusConnection *conn, const char *name);
 int            dbusif_add_matches      (DBusConnection *conn, const char *const *rule);
 int            dbusif_remove_matches   (DBusConnection *conn, const char *const *rule);
@@ -28,6 +28,8 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 static inline int
 itoc(int i)
@@ -53,6 +55,76 @@ esc_p(int c)
   return (c < 32u) || (c == '\\') || (c > 126u);
 }
 
+/* ------------------------------------------------------------------------- *
+ * word-at-a-time scanning
+ *
+ * Eight bytes are tested at once for anything that needs attention;
+ * a hit is then located with the byte-wise tests. The word tests may
+ * flag bytes following the first match, but never miss one, so only
+ * the presence of a hit is used.
+ * ------------------------------------------------------------------------- */
+
+#define ESC_ONES 0x0101010101010101ull
+#define ESC_HIGH 0x8080808080808080ull
+
+/* nonzero if some byte in w is zero */
+static inline uint64_t
+esc_word_zero(uint64_t w)
+{
+  return (w - ESC_ONES) & ~w & ESC_HIGH;
+}
+
+/* nonzero if some byte in w is less than n, n <= 128 */
+static inline uint64_t
+esc_word_less(uint64_t w, unsigned n)
+{
+  return (w - ESC_ONES * n) & ~w & ESC_HIGH;
+}
+
+/* nonzero if some byte in w satisfies esc_p() */
+static inline uint64_t
+esc_word_p(uint64_t w)
+{
+  return (esc_word_less(w, 32) |
+          (w & ESC_HIGH) |
+          esc_word_zero(w ^ (ESC_ONES * '\\')) |
+          esc_word_zero(w ^ (ESC_ONES * 127)));
+}
+
+/* length of leading run of chars that can be written as is */
+static inline size_t
+esc_span(const char *src, size_t len)
+{
+  size_t   i = 0;
+  uint64_t w;
+
+  for( ; i + sizeof w <= len; i += sizeof w )
+  {
+    memcpy(&w, src + i, sizeof w);
+    if( esc_word_p(w) ) break;
+  }
+  while( i < len && !esc_p(src[i]) ) ++i;
+
+  return i;
+}
+
+/* length of leading run of chars that decode to themselves */
+static inline size_t
+unesc_span(const char *src, size_t len)
+{
+  size_t   i = 0;
+  uint64_t w;
+
+  for( ; i + sizeof w <= len; i += sizeof w )
+  {
+    memcpy(&w, src + i, sizeof w);
+    if( esc_word_zero(w) | esc_word_zero(w ^ (ESC_ONES * '\\')) ) break;
+  }
+  while( i < len && src[i] != '\\' && src[i] != 0 ) ++i;
+
+  return i;
+}
+
 static inline int
 output_esc(FILE *f, int c)
 {
@@ -80,30 +152,27 @@ escape_putline(FILE *file, const char *fmt, ...)
 {
   int   err = -1;
   char *txt = 0;
+  int   len = 0;
   va_list va;
 
   va_start(va, fmt);
 
-  if( vasprintf(&txt, fmt, va) == -1 )
+  if( (len = vasprintf(&txt, fmt, va)) == -1 )
   {
     goto cleanup;
   }
 
-  for( char *pos = txt; *pos; ++pos )
+  for( char *pos = txt, *end = txt + len; pos < end; )
   {
-    if( esc_p(*pos) )
+    size_t n = esc_span(pos, end - pos);
+
+    if( n != 0 && fwrite(pos, 1, n, file) != n )
     {
-      if( output_esc(file, *pos) == EOF )
-      {
-        goto cleanup;
-      }
+      goto cleanup;
     }
-    else
+    if( (pos += n) < end && output_esc(file, *pos++) == EOF )
     {
-      if( putc(*pos, file) == EOF )
-      {
-        goto cleanup;
-      }
+      goto cleanup;
     }
   }
 
@@ -121,37 +190,67 @@ escape_putline(FILE *file, const char *fmt, ...)
   return err;
 }
 
-int
-escape_getline(FILE *file, char **pbuff, size_t *psize)
+size_t
+escape_encode(char *dst, const char *src)
 {
-  int    err  = -1;
-  char  *buff = *pbuff;
-  size_t size = *psize;
+  char       *pos = dst;
+  const char *end = src + strlen(src);
 
-  int n,l,h;
-
-  if( (n = getline(&buff, &size, file)) == -1 )
+  while( src < end )
   {
-    goto cleanup;
-  }
+    size_t n = esc_span(src, end - src);
 
-  while( (n > 0) && (buff[n-1] <= 32u) )
-  {
-    buff[--n] = 0;
+    memcpy(pos, src, n), pos += n, src += n;
+
+    if( src == end )
+    {
+      break;
+    }
+
+    int c = *src++;
+
+    *pos++ = '\\';
+
+    switch( c )
+    {
+    case '\\': *pos++ = '\\'; break;
+    case '\b': *pos++ = 'b';  break;
+    case '\n': *pos++ = 'n';  break;
+    case '\r': *pos++ = 'r';  break;
+    case '\t': *pos++ = 't';  break;
+    default:
+      *pos++ = 'x';
+      *pos++ = itoc((c >> 4)&15);
+      *pos++ = itoc((c >> 0)&15);
+      break;
+    }
   }
 
-  char *src = buff;
-  char *dst = buff;
+  *pos = 0;
+  return pos - dst;
+}
+
+char *
+escape_decode(char *dst, const char *src, const char *end)
+{
+  int n,l,h;
 
-  while( (n = *src++) != 0 )
+  while( src < end )
   {
-    if( n != '\\' )
+    size_t len = unesc_span(src, end - src);
+
+    if( dst != src )
+    {
+      memmove(dst, src, len);
+    }
+    dst += len, src += len;
+
+    if( src == end || *src++ == 0 )
     {
-      *dst++ = n;
-      continue;
+      break;
     }
 
-    switch( (n = *src++) )
+    switch( (n = (src < end) ? *src++ : 0) )
     {
     case '\\': *dst++ = '\\'; break;
     case 'b':  *dst++ = '\b'; break;
@@ -160,18 +259,44 @@ escape_getline(FILE *file, char **pbuff, size_t *psize)
     case 't':  *dst++ = '\t'; break;
 
     case 'x':
-      if( (h = ctoi(*src++)) == -1 ) goto cleanup;
-      if( (l = ctoi(*src++)) == -1 ) goto cleanup;
+      if( src >= end || (h = ctoi(*src++)) == -1 ) return 0;
+      if( src >= end || (l = ctoi(*src++)) == -1 ) return 0;
       *dst++ = (h << 4) | (l << 0);
       break;
 
     default:
-      goto cleanup;
+      return 0;
     }
-
   }
 
   *dst = 0;
+  return dst;
+}
+
+int
+escape_getline(FILE *file, char **pbuff, size_t *psize)
+{
+  int    err  = -1;
+  char  *buff = *pbuff;
+  size_t size = *psize;
+
+  int n;
+
+  if( (n = getline(&buff, &size, file)) == -1 )
+  {
+    goto cleanup;
+  }
+
+  while( (n > 0) && (buff[n-1] <= 32u) )
+  {
+    buff[--n] = 0;
+  }
+
+  if( escape_decode(buff, buff, buff + n) == 0 )
+  {
+    goto cleanup;
+  }
+
   err = 0;
 
   cleanup:
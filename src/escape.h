@@ -36,6 +36,14 @@ extern "C" {
 int escape_putline(FILE *file, const char *fmt, ...);
 int escape_getline(FILE *file, char **pbuff, size_t *psize);
 
+/* encode text as escape_putline() would write it, dst must have room
+ * for 4 * strlen(src) + 1 chars; returns length of encoded text */
+size_t escape_encode(char *dst, const char *src);
+
+/* decode escaped text in [src, end) to dst, which may be the same as
+ * src; returns the position of terminating nul or NULL on bad escape */
+char *escape_decode(char *dst, const char *src, const char *end);
+
 #ifdef __cplusplus
 };
 #endif
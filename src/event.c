@@ -29,6 +29,7 @@
 #include "logging.h"
 #include "xutil.h"
 #include "ticker.h"
+#include "pool.h"
 
 #include <stdio.h>
 
@@ -117,7 +118,7 @@ alarm_event_dtor(alarm_event_t *self)
 alarm_event_t *
 alarm_event_create(void)
 {
-  alarm_event_t *self = calloc(1, sizeof *self);
+  alarm_event_t *self = pool_alloc(&pool_event);
   alarm_event_ctor(self);
   return self;
 }
@@ -129,7 +130,7 @@ alarm_event_create(void)
 alarm_event_t *
 alarm_event_create_ex(size_t actions)
 {
-  alarm_event_t *self = calloc(1, sizeof *self);
+  alarm_event_t *self = pool_alloc(&pool_event);
 
   alarm_event_ctor(self);
 
@@ -148,7 +149,7 @@ alarm_event_delete(alarm_event_t *self)
   if( self != 0 )
   {
     alarm_event_dtor(self);
-    free(self);
+    pool_release(&pool_event, self);
   }
 }
 
@@ -270,7 +271,7 @@ alarm_event_del_actions(alarm_event_t *self)
   {
     alarm_action_dtor(&self->action_tab[i]);
   }
-  free(self->action_tab);
+  pool_table_release(pool_action, self->action_cnt, self->action_tab);
   self->action_tab = 0;
   self->action_cnt = 0;
 }
@@ -290,8 +291,16 @@ alarm_event_add_actions(alarm_event_t *self, size_t count)
 
     self->action_cnt += count;
 
-    self->action_tab = realloc(self->action_tab,
-                               self->action_cnt * sizeof *self->action_tab);
+    if( self->action_tab == 0 )
+    {
+      self->action_tab = pool_table_alloc(pool_action, self->action_cnt,
+                                          sizeof *self->action_tab);
+    }
+    else
+    {
+      self->action_tab = realloc(self->action_tab,
+                                 self->action_cnt * sizeof *self->action_tab);
+    }
 
     for( size_t i = previously; i < self->action_cnt; ++i )
     {
@@ -314,7 +323,7 @@ alarm_event_del_recurrences(alarm_event_t *self)
   {
     alarm_recur_dtor(&self->recurrence_tab[i]);
   }
-  free(self->recurrence_tab);
+  pool_table_release(pool_recur, self->recurrence_cnt, self->recurrence_tab);
   self->recurrence_tab  = 0;
   self->recurrence_cnt = 0;
 }
@@ -334,8 +343,16 @@ alarm_event_add_recurrences(alarm_event_t *self, size_t count)
 
     self->recurrence_cnt += count;
 
-    self->recurrence_tab = realloc(self->recurrence_tab,
-                                   self->recurrence_cnt * sizeof *self->recurrence_tab);
+    if( self->recurrence_tab == 0 )
+    {
+      self->recurrence_tab = pool_table_alloc(pool_recur, self->recurrence_cnt,
+                                              sizeof *self->recurrence_tab);
+    }
+    else
+    {
+      self->recurrence_tab = realloc(self->recurrence_tab,
+                                     self->recurrence_cnt * sizeof *self->recurrence_tab);
+    }
 
     for( size_t i = previously; i < self->recurrence_cnt; ++i )
     {
@@ -842,6 +859,50 @@ alarm_event_is_sane(const alarm_event_t *event)
   return (err&2) ? -1 : err ? 0 : 1;
 }
 
+/* ------------------------------------------------------------------------- *
+ * attribute table
+ *
+ * The attr_tab is kept sorted by attr_name, so that lookups can use
+ * binary search. The public structure has no room for the allocated
+ * size, and tables of exactly attr_cnt entries are made elsewhere
+ * too (queue_event_flatten(), clients), so the table is always
+ * reallocated to the exact size needed.
+ * ------------------------------------------------------------------------- */
+
+static
+void
+alarm_event_attr_reserve(alarm_event_t *self, size_t count)
+{
+  if( count > self->attr_cnt )
+  {
+    self->attr_tab = realloc(self->attr_tab, count * sizeof *self->attr_tab);
+  }
+}
+
+static
+size_t
+alarm_event_attr_search(const alarm_event_t *self, size_t count,
+                        const char *name, int *pfound)
+{
+  size_t lo = 0, hi = count;
+
+  while( lo < hi )
+  {
+    size_t i = lo + (hi - lo) / 2;
+    int    r = strcmp(self->attr_tab[i]->attr_name, name);
+
+    if( r == 0 )
+    {
+      *pfound = 1;
+      return i;
+    }
+    if( r < 0 ) lo = i + 1; else hi = i;
+  }
+
+  *pfound = 0;
+  return lo;
+}
+
 void
 alarm_event_del_attrs(alarm_event_t *self)
 {
@@ -858,35 +919,26 @@ alarm_event_del_attrs(alarm_event_t *self)
 void
 alarm_event_rem_attr(alarm_event_t *self, const char *name)
 {
-  size_t k = 0;
-  for( size_t i = 0; i < self->attr_cnt; ++i )
+  int    found = 0;
+  size_t i     = alarm_event_attr_search(self, self->attr_cnt, name, &found);
+
+  if( found )
   {
-    alarm_attr_t *att = self->attr_tab[i];
-    if( !strcmp(att->attr_name, name) )
-    {
-      alarm_attr_delete(att);
-    }
-    else
-    {
-      self->attr_tab[k++] = att;
-    }
+    alarm_attr_delete(self->attr_tab[i]);
+
+    self->attr_cnt -= 1;
+    memmove(&self->attr_tab[i], &self->attr_tab[i+1],
+            (self->attr_cnt - i) * sizeof *self->attr_tab);
   }
-  self->attr_cnt = k;
 }
 
 alarm_attr_t *
 alarm_event_get_attr(alarm_event_t *self, const char *name)
 {
+  int    found = 0;
+  size_t i     = alarm_event_attr_search(self, self->attr_cnt, name, &found);
 
-  for( size_t i = 0; i < self->attr_cnt; ++i )
-  {
-    alarm_attr_t *res = self->attr_tab[i];
-    if( !strcmp(res->attr_name, name) )
-    {
-      return res;
-    }
-  }
-  return 0;
+  return found ? self->attr_tab[i] : 0;
 }
 
 int
@@ -898,19 +950,135 @@ alarm_event_has_attr(alarm_event_t *self, const char *name)
 alarm_attr_t *
 alarm_event_add_attr(alarm_event_t *self, const char *name)
 {
-  alarm_attr_t *res = alarm_event_get_attr(self, name);
+  int    found = 0;
+  size_t i     = alarm_event_attr_search(self, self->attr_cnt, name, &found);
 
-  if( res == 0 )
+  if( !found )
   {
-    res = alarm_attr_create(name);
+    alarm_event_attr_reserve(self, self->attr_cnt + 1);
 
+    memmove(&self->attr_tab[i+1], &self->attr_tab[i],
+            (self->attr_cnt - i) * sizeof *self->attr_tab);
+    self->attr_tab[i] = alarm_attr_create(name);
     self->attr_cnt += 1;
-    self->attr_tab = realloc(self->attr_tab,
-                             self->attr_cnt * sizeof *self->attr_tab);
-    self->attr_tab[self->attr_cnt-1] = res;
   }
 
-  return res;
+  return self->attr_tab[i];
+}
+
+void
+alarm_event_set_attrs(alarm_event_t *self, const alarm_attr_t *attrs, size_t count)
+{
+  size_t  *order = 0;
+  size_t   have  = self->attr_cnt;
+  size_t   todo  = 0;
+
+  auto int cmp(const void *a, const void *b);
+
+  auto int cmp(const void *a, const void *b)
+  {
+    size_t i = *(const size_t *)a;
+    size_t j = *(const size_t *)b;
+    int    r = strcmp(attrs[i].attr_name, attrs[j].attr_name);
+    return r ?: (i < j) ? -1 : (i > j);
+  }
+
+  if( count == 0 )
+  {
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * sort input by name; of duplicates the
+   * last one given is used
+   * - - - - - - - - - - - - - - - - - - - */
+
+  order = malloc(count * sizeof *order);
+
+  for( size_t i = 0; i < count; ++i )
+  {
+    order[i] = i;
+  }
+  qsort(order, count, sizeof *order, cmp);
+
+  for( size_t i = 0; i < count; ++i )
+  {
+    if( i + 1 < count &&
+        !strcmp(attrs[order[i]].attr_name, attrs[order[i+1]].attr_name) )
+    {
+      continue;
+    }
+    order[todo++] = order[i];
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * update existing attributes in place,
+   * new ones go to the end in name order
+   * - - - - - - - - - - - - - - - - - - - */
+
+  alarm_event_attr_reserve(self, have + todo);
+
+  for( size_t i = 0; i < todo; ++i )
+  {
+    const alarm_attr_t *src = &attrs[order[i]];
+    int                 found = 0;
+    size_t              k = alarm_event_attr_search(self, have, src->attr_name, &found);
+    alarm_attr_t       *dst = 0;
+
+    if( found )
+    {
+      dst = self->attr_tab[k];
+    }
+    else
+    {
+      dst = alarm_attr_create(src->attr_name);
+      self->attr_tab[self->attr_cnt++] = dst;
+    }
+
+    switch( src->attr_type )
+    {
+    default:
+    case ALARM_ATTR_NULL:
+      alarm_attr_set_null(dst);
+      break;
+    case ALARM_ATTR_INT:
+      alarm_attr_set_int(dst, src->attr_data.ival);
+      break;
+    case ALARM_ATTR_TIME:
+      alarm_attr_set_time(dst, src->attr_data.tval);
+      break;
+    case ALARM_ATTR_STRING:
+      alarm_attr_set_string(dst, src->attr_data.sval);
+      break;
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * merge the two sorted runs
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( have != 0 && self->attr_cnt > have )
+  {
+    size_t          cnt = self->attr_cnt;
+    alarm_attr_t  **tab = self->attr_tab;
+    alarm_attr_t  **tmp = malloc(cnt * sizeof *tmp);
+    size_t          i = 0, j = have, k = 0;
+
+    while( i < have && j < cnt )
+    {
+      tmp[k++] = (strcmp(tab[i]->attr_name, tab[j]->attr_name) < 0) ?
+        tab[i++] : tab[j++];
+    }
+    while( i < have ) tmp[k++] = tab[i++];
+    while( j < cnt  ) tmp[k++] = tab[j++];
+
+    memcpy(tab, tmp, cnt * sizeof *tab);
+    free(tmp);
+  }
+
+  cleanup:
+
+  free(order);
 }
 
 void
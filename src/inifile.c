@@ -30,11 +30,12 @@
 #include "unique.h"
 #include "escape.h"
 
+#include <assert.h>
 #include <errno.h>
-
-#ifdef DEAD_CODE
-# include <unistd.h>
-#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* ========================================================================= *
  * inival_t  --  methods
@@ -112,6 +113,16 @@ inival_compare_cb(const void *self, const void *key)
   return inival_compare(self, key);
 }
 
+/* ------------------------------------------------------------------------- *
+ * inival_key_cb
+ * ------------------------------------------------------------------------- */
+
+const void *
+inival_key_cb(const void *self)
+{
+  return ((const inival_t *)self)->iv_key;
+}
+
 /* ------------------------------------------------------------------------- *
  * inival_delete_cb
  * ------------------------------------------------------------------------- */
@@ -134,10 +145,13 @@ void
 inisec_ctor(inisec_t *self)
 {
   self->is_name   = 0;
+  self->is_arena  = 0;
 
-  symtab_ctor(&self->is_values,
-              inival_delete_cb,
-              inival_compare_cb);
+  symtab_ctor_hashed(&self->is_values,
+                     inival_delete_cb,
+                     inival_compare_cb,
+                     inival_key_cb,
+                     symtab_hash_string);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -149,7 +163,10 @@ inisec_dtor(inisec_t *self)
 {
   symtab_dtor(&self->is_values);
 
-  free(self->is_name);
+  if( self->is_arena == 0 )
+  {
+    free(self->is_name);
+  }
 }
 
 /* ------------------------------------------------------------------------- *
@@ -167,6 +184,32 @@ inisec_create(const char *name)
   return self;
 }
 
+/* ------------------------------------------------------------------------- *
+ * inisec_create_in_arena  --  create section with storage from arena
+ * ------------------------------------------------------------------------- */
+
+static
+inisec_t *
+inisec_create_in_arena(arena_t *arena, char *name)
+{
+  /* the section, its values and the value table are all
+   * taken from the arena and released only with it */
+
+  inisec_t *self = arena_alloc(arena, sizeof *self);
+
+  self->is_name  = name;
+  self->is_arena = arena;
+
+  symtab_ctor_hashed(&self->is_values,
+                     0,
+                     inival_compare_cb,
+                     inival_key_cb,
+                     symtab_hash_string);
+  symtab_set_arena(&self->is_values, arena);
+
+  return self;
+}
+
 /* ------------------------------------------------------------------------- *
  * inisec_delete
  * ------------------------------------------------------------------------- */
@@ -201,6 +244,16 @@ inisec_compare_cb(const void *self, const void *name)
   return inisec_compare(self, name);
 }
 
+/* ------------------------------------------------------------------------- *
+ * inisec_key_cb
+ * ------------------------------------------------------------------------- */
+
+const void *
+inisec_key_cb(const void *self)
+{
+  return ((const inisec_t *)self)->is_name;
+}
+
 /* ------------------------------------------------------------------------- *
  * inisec_delete_cb
  * ------------------------------------------------------------------------- */
@@ -211,6 +264,28 @@ inisec_delete_cb(void *self)
   inisec_delete(self);
 }
 
+/* ------------------------------------------------------------------------- *
+ * inisec_set_nocopy  --  set value in arena section without copying strings
+ * ------------------------------------------------------------------------- */
+
+static
+void
+inisec_set_nocopy(inisec_t *self, char *key, char *val)
+{
+  inival_t *res = symtab_lookup(&self->is_values, key);
+  if( res == 0 )
+  {
+    res = arena_alloc(self->is_arena, sizeof *res);
+    res->iv_key = key;
+    res->iv_val = val;
+    symtab_append(&self->is_values, res);
+  }
+  else
+  {
+    res->iv_val = val;
+  }
+}
+
 /* ------------------------------------------------------------------------- *
  * inisec_set
  * ------------------------------------------------------------------------- */
@@ -219,7 +294,14 @@ void
 inisec_set(inisec_t *self, const char *key, const char *val)
 {
   inival_t *res = symtab_lookup(&self->is_values, key);
-  if( res == 0 )
+
+  if( self->is_arena != 0 )
+  {
+    inisec_set_nocopy(self,
+                      res ? res->iv_key : arena_strdup(self->is_arena, key),
+                      arena_strdup(self->is_arena, val));
+  }
+  else if( res == 0 )
   {
     res = inival_create(key, val);
     symtab_append(&self->is_values, res);
@@ -321,9 +403,17 @@ inifile_ctor(inifile_t *self)
 {
   self->if_path     = 0;
 
-  symtab_ctor(&self->if_sections,
-              inisec_delete_cb,
-              inisec_compare_cb);
+  /* sections, values and strings are allocated from arena,
+   * the whole tree is released by destroying the arena */
+
+  arena_ctor(&self->if_arena);
+
+  symtab_ctor_hashed(&self->if_sections,
+                     0,
+                     inisec_compare_cb,
+                     inisec_key_cb,
+                     symtab_hash_string);
+  symtab_set_arena(&self->if_sections, &self->if_arena);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -334,6 +424,7 @@ void
 inifile_dtor(inifile_t *self)
 {
   symtab_dtor(&self->if_sections);
+  arena_dtor(&self->if_arena);
 
   free(self->if_path);
 }
@@ -410,7 +501,25 @@ inifile_add_section(inifile_t *self, const char *sec)
   inisec_t *res = symtab_lookup(&self->if_sections, sec);
   if( res == 0 )
   {
-    res = inisec_create(sec);
+    res = inisec_create_in_arena(&self->if_arena,
+                                 arena_strdup(&self->if_arena, sec));
+    symtab_append(&self->if_sections, res);
+  }
+  return res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * inifile_add_section_nocopy  --  add section named by arena string
+ * ------------------------------------------------------------------------- */
+
+static
+inisec_t *
+inifile_add_section_nocopy(inifile_t *self, char *sec)
+{
+  inisec_t *res = symtab_lookup(&self->if_sections, sec);
+  if( res == 0 )
+  {
+    res = inisec_create_in_arena(&self->if_arena, sec);
     symtab_append(&self->if_sections, res);
   }
   return res;
@@ -663,69 +772,305 @@ inifile_save_to_memory(const inifile_t *self, char **pdata, size_t *psize)
 }
 
 /* ------------------------------------------------------------------------- *
- * inifile_load
+ * iniwriter_reserve  --  make room for at least size more chars
  * ------------------------------------------------------------------------- */
 
-int
-inifile_load(inifile_t *self, const char *path)
+static
+char *
+iniwriter_reserve(iniwriter_t *self, size_t size)
 {
-  int     err  = -1;
-  FILE   *file = 0;
-  size_t  size = 0;
-  char   *data = 0;
+  size_t need = self->iw_size + size + 1;
 
-  inisec_t *sec = 0;
-  char     *key  = 0;
-  char     *val  = 0;
+  if( need > self->iw_alloc )
+  {
+    size_t alloc = self->iw_alloc ? self->iw_alloc : 4096;
+
+    while( alloc < need )
+    {
+      alloc *= 2;
+    }
+    self->iw_data  = realloc(self->iw_data, alloc);
+    self->iw_alloc = alloc;
+  }
+  return self->iw_data + self->iw_size;
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_put  --  append text, escaped as escape_putline() would
+ * ------------------------------------------------------------------------- */
+
+static
+void
+iniwriter_put(iniwriter_t *self, const char *str)
+{
+  char *pos = iniwriter_reserve(self, 4 * strlen(str));
+  self->iw_size += escape_encode(pos, str);
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_putc  --  append plain char
+ * ------------------------------------------------------------------------- */
+
+static
+void
+iniwriter_putc(iniwriter_t *self, int chr)
+{
+  char *pos = iniwriter_reserve(self, 1);
+  pos[0] = chr, pos[1] = 0;
+  self->iw_size += 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+iniwriter_ctor(iniwriter_t *self)
+{
+  self->iw_data    = 0;
+  self->iw_size    = 0;
+  self->iw_alloc   = 0;
+  self->iw_section = 0;
+  self->iw_open    = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+iniwriter_dtor(iniwriter_t *self)
+{
+  free(self->iw_data);
+  iniwriter_ctor(self);
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_begin  --  start section, header is written lazily
+ * ------------------------------------------------------------------------- */
+
+void
+iniwriter_begin(iniwriter_t *self, const char *sec)
+{
+  iniwriter_end(self);
+  self->iw_section = sec;
+}
 
-  if( (file = fopen(path, "r")) == 0 )
+/* ------------------------------------------------------------------------- *
+ * iniwriter_end  --  terminate current section
+ * ------------------------------------------------------------------------- */
+
+void
+iniwriter_end(iniwriter_t *self)
+{
+  if( self->iw_open )
   {
-    log_error("can't open '%s' for reading: %s\n", path, strerror(errno));
-    goto cleanup;
+    iniwriter_putc(self, '\n');
   }
+  self->iw_section = 0;
+  self->iw_open    = 0;
+}
 
-  for( ;; )
+/* ------------------------------------------------------------------------- *
+ * iniwriter_set  --  write "<pfx><key>: <val>" line to current section
+ * ------------------------------------------------------------------------- */
+
+void
+iniwriter_set(iniwriter_t *self, const char *pfx, const char *key,
+              const char *val)
+{
+  assert( self->iw_section != 0 );
+
+  if( !self->iw_open )
+  {
+    self->iw_open = 1;
+    iniwriter_putc(self, BRA);
+    iniwriter_put(self, self->iw_section);
+    iniwriter_putc(self, KET);
+    iniwriter_putc(self, '\n');
+  }
+
+  if( pfx != 0 )
   {
-    ssize_t n = escape_getline(file, &data, &size);
+    iniwriter_put(self, pfx);
+  }
+  iniwriter_put(self, key);
+  iniwriter_putc(self, SEP);
+  iniwriter_putc(self, ' ');
+  iniwriter_put(self, val);
+  iniwriter_putc(self, '\n');
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_append  --  add previously written ini text as is
+ * ------------------------------------------------------------------------- */
+
+void
+iniwriter_append(iniwriter_t *self, const char *text, size_t size)
+{
+  iniwriter_end(self);
+
+  memcpy(iniwriter_reserve(self, size), text, size);
+  self->iw_size += size;
+  self->iw_data[self->iw_size] = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_steal  --  finish output and hand buffer over to caller
+ * ------------------------------------------------------------------------- */
+
+char *
+iniwriter_steal(iniwriter_t *self, size_t *psize)
+{
+  char *data;
 
-    if( n == -1 ) break;
+  iniwriter_end(self);
+  iniwriter_reserve(self, 0);
 
-    if( *data == 0 ) continue;
+  data   = self->iw_data;
+  *psize = self->iw_size;
 
-    if( *data == '#' ) continue;
+  iniwriter_ctor(self);
+  return data;
+}
+
+/* ------------------------------------------------------------------------- *
+ * inifile_load_from_buffer  --  parse ini data in one pass over memory
+ * ------------------------------------------------------------------------- */
+
+static
+void
+inifile_load_from_buffer(inifile_t *self, const char *data, size_t size)
+{
+  /* The text is unescaped line by line into one arena buffer,
+   * section names, keys and values are stored as pointers to
+   * it instead of separate copies */
+
+  char       *buff = arena_alloc(&self->if_arena, size + 1);
+  char       *line = buff;
+  const char *src  = data;
+  const char *end  = data + size;
+
+  inisec_t *sec = 0;
+  char     *key = 0;
+  char     *val = 0;
+
+  while( src < end )
+  {
+    const char *eol = memchr(src, '\n', end - src) ?: end;
+    const char *nxt = (eol < end) ? (eol + 1) : end;
 
-    if( *data == BRA )
+    /* trailing white space is ignored, as with escape_getline() */
+    while( (eol > src) && ((unsigned char)eol[-1] <= 32u) )
     {
-      char *pos = data;
+      --eol;
+    }
+
+    char *text = line;
+
+    if( (line = escape_decode(text, src, eol)) == 0 ) break;
+
+    line += 1, src = nxt;
+
+    if( *text == 0 ) continue;
+
+    if( *text == '#' ) continue;
+
+    if( *text == BRA )
+    {
+      char *pos = text;
       xsplit(&pos, BRA);
       char *name = xstripall(xsplit(&pos, KET));
 
-      sec = inifile_add_section(self, name);
+      sec = inifile_add_section_nocopy(self, name);
       continue;
     }
 
-    val = data;
+    val = text;
     key = xsplit(&val, SEP);
     xstripall(key);
     xstrip(val);
 
     if( sec && *key )
     {
-      inisec_set(sec, key, val);
+      inisec_set_nocopy(sec, key, val);
     }
   }
+}
+
+/* ------------------------------------------------------------------------- *
+ * inifile_load
+ * ------------------------------------------------------------------------- */
+
+int
+inifile_load(inifile_t *self, const char *path)
+{
+  int     err  = -1;
+  int     file = -1;
+  void   *data = MAP_FAILED;
+  size_t  size = 0;
+
+  struct stat st;
+
+  if( (file = open(path, O_RDONLY)) == -1 )
+  {
+    log_error("can't open '%s' for reading: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  if( fstat(file, &st) == -1 )
+  {
+    log_error("%s: stat: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  if( (size = st.st_size) != 0 )
+  {
+    data = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    if( data == MAP_FAILED )
+    {
+      log_error("%s: mmap: %s\n", path, strerror(errno));
+      goto cleanup;
+    }
+
+    inifile_load_from_buffer(self, data, size);
+  }
 
   err = 0;
 
   cleanup:
 
-  free(data);
-
-  if( file != 0 ) fclose(file);
+  if( data != MAP_FAILED ) munmap(data, size);
+  if( file != -1 ) close(file);
 
   return err;
 }
 
+/* ------------------------------------------------------------------------- *
+ * inifile_load_from_memory
+ * ------------------------------------------------------------------------- */
+
+int
+inifile_load_from_memory(inifile_t *self, const char *data, size_t size)
+{
+  inifile_load_from_buffer(self, data, size);
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * inifile_get_memory_usage  --  arena statistics for inifile tree
+ * ------------------------------------------------------------------------- */
+
+void
+inifile_get_memory_usage(const inifile_t *self, size_t *pblocks,
+                         size_t *pused, size_t *psize)
+{
+  if( pblocks ) *pblocks = self->if_arena.ar_blocks;
+  if( pused   ) *pused   = self->if_arena.ar_used;
+  if( psize   ) *psize   = self->if_arena.ar_size;
+}
+
 /* ------------------------------------------------------------------------- *
  * inifile_scan_sections
  * ------------------------------------------------------------------------- */
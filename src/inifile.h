@@ -29,6 +29,7 @@
 
 #include "xutil.h"
 #include "symtab.h"
+#include "arena.h"
 
 # ifdef __cplusplus
 extern "C" {
@@ -62,15 +63,20 @@ inival_t *inival_create    (const char *key, const char *val);
 void      inival_delete    (inival_t *self);
 int       inival_compare   (const inival_t *self, const char *key);
 int       inival_compare_cb(const void *self, const void *key);
+const void *inival_key_cb  (const void *self);
 void      inival_delete_cb (void *self);
 
 /* ------------------------------------------------------------------------- *
  * inisec_t
  * ------------------------------------------------------------------------- */
 
+/* sections of an inifile take the values and strings from
+ * the arena of the inifile, standalone ones use the heap */
+
 struct inisec_t
 {
   char      *is_name;
+  arena_t   *is_arena;
   symtab_t   is_values;
 };
 
@@ -80,6 +86,7 @@ inisec_t   *inisec_create    (const char *name);
 void        inisec_delete    (inisec_t *self);
 int         inisec_compare   (const inisec_t *self, const char *name);
 int         inisec_compare_cb(const void *self, const void *name);
+const void *inisec_key_cb    (const void *self);
 void        inisec_delete_cb (void *self);
 void        inisec_set       (inisec_t *self, const char *key, const char *val);
 const char *inisec_get       (inisec_t *self, const char *key, const char *val);
@@ -89,7 +96,14 @@ void        inisec_emit      (const inisec_t *self, FILE *file);
 
 static inline void inisec_set_name(inisec_t *self, const char *name)
 {
-  xstrset(&self->is_name, name);
+  if( self->is_arena != 0 )
+  {
+    self->is_name = arena_strdup(self->is_arena, name);
+  }
+  else
+  {
+    xstrset(&self->is_name, name);
+  }
 }
 
 static inline const char *inisec_get_name(inisec_t *self)
@@ -104,6 +118,7 @@ static inline const char *inisec_get_name(inisec_t *self)
 struct inifile_t
 {
   char      *if_path;
+  arena_t    if_arena;
   symtab_t   if_sections;
 };
 
@@ -127,12 +142,42 @@ int          inifile_has              (inifile_t *self, const char *sec, const c
 void         inifile_emit             (const inifile_t *self, FILE *file);
 int          inifile_save             (const inifile_t *self, const char *path);
 int          inifile_load             (inifile_t *self, const char *path);
+int          inifile_load_from_memory (inifile_t *self, const char *data, size_t size);
 inisec_t   * inifile_scan_sections    (const inifile_t *self, int (*cb)(const inisec_t*, void*), void *aptr);
 inival_t   * inifile_scan_values      (const inifile_t *self, int (*cb)(const inisec_t *, const inival_t*, void*), void *aptr);
 char       **inifile_get_section_names(const inifile_t *self, size_t *pcount);
 char       **inifile_get_value_keys   (const inifile_t *self, size_t *pcount);
 void         inifile_to_csv           (const inifile_t *self);
 int          inifile_save_to_memory   (const inifile_t *self, char **pdata, size_t *psize);
+void         inifile_get_memory_usage (const inifile_t *self, size_t *pblocks, size_t *pused, size_t *psize);
+
+/* ------------------------------------------------------------------------- *
+ * iniwriter_t
+ * ------------------------------------------------------------------------- */
+
+/* writes ini text directly to a growable buffer, the output is
+ * identical to what inifile_save_to_memory() would give for an
+ * inifile with the same sections and values; header of a section
+ * is written only when the first value is added to it */
+
+typedef struct iniwriter_t iniwriter_t;
+
+struct iniwriter_t
+{
+  char       *iw_data;
+  size_t      iw_size;
+  size_t      iw_alloc;
+  const char *iw_section;
+  int         iw_open;
+};
+
+void  iniwriter_ctor (iniwriter_t *self);
+void  iniwriter_dtor (iniwriter_t *self);
+void  iniwriter_begin(iniwriter_t *self, const char *sec);
+void  iniwriter_end  (iniwriter_t *self);
+void  iniwriter_set  (iniwriter_t *self, const char *pfx, const char *key, const char *val);
+void  iniwriter_append(iniwriter_t *self, const char *text, size_t size);
+char *iniwriter_steal(iniwriter_t *self, size_t *psize);
 
 # ifdef __cplusplus
 };
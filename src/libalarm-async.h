@@ -181,6 +181,75 @@ int alarmd_event_del_decode_rsp (DBusMessage *rsp);
 
 /*@}*/
 
+/** @name Helpers for ALARMD_EVENTS_ADD
+ */
+
+/*@{*/
+
+/** \brief construct batch add method call message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_add_many() for details.
+ */
+DBusMessage *alarmd_event_add_many_encode_req (alarm_event_t * const *events, int count);
+
+/** \brief parse batch add method reply message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_add_many() for details.
+ */
+int alarmd_event_add_many_decode_rsp (DBusMessage *rsp, cookie_t *cookies, int count);
+
+/*@}*/
+
+/** @name Helpers for ALARMD_EVENTS_UPDATE
+ */
+
+/*@{*/
+
+/** \brief construct batch update method call message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_update_many() for details.
+ */
+DBusMessage *alarmd_event_update_many_encode_req (alarm_event_t * const *events, int count);
+
+/** \brief parse batch update method reply message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_update_many() for details.
+ */
+int alarmd_event_update_many_decode_rsp (DBusMessage *rsp, cookie_t *cookies, int count);
+
+/*@}*/
+
+/** @name Helpers for ALARMD_EVENTS_DEL
+ */
+
+/*@{*/
+
+/** \brief construct batch del method call message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_del_many() for details.
+ */
+DBusMessage *alarmd_event_del_many_encode_req (const cookie_t *cookies, int count);
+
+/** \brief parse batch del method reply message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_del_many() for details.
+ */
+int alarmd_event_del_many_decode_rsp (DBusMessage *rsp);
+
+/*@}*/
+
 /** @name Helpers for ALARMD_EVENT_QUERY
  */
 
@@ -204,6 +273,29 @@ cookie_t *alarmd_event_query_decode_rsp (DBusMessage *rsp);
 
 /*@}*/
 
+/** @name Helpers for ALARMD_EVENT_QUERY_FULL
+ */
+
+/*@{*/
+
+/** \brief construct full query method call message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_query_full() for details.
+ */
+DBusMessage *alarmd_event_query_full_encode_req (const time_t first, const time_t last, int32_t flag_mask, int32_t flags, const char *appid, unsigned offset, unsigned limit);
+
+/** \brief parse full query method reply message
+ *
+ *  @since 1.1.24
+ *
+ *  See #alarmd_event_query_full() for details.
+ */
+alarm_event_t **alarmd_event_query_full_decode_rsp (DBusMessage *rsp);
+
+/*@}*/
+
 /** @name Helpers for ALARMD_SNOOZE_GET
  */
 
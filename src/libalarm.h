@@ -1249,6 +1249,7 @@ typedef enum alarmeventflags
  * - #alarm_event_get_attr()
  * - #alarm_event_has_attr()
  * - #alarm_event_add_attr()
+ * - #alarm_event_set_attrs()
  *
  * - #alarm_event_is_recurring()
  * - #alarm_event_is_sane()
@@ -1445,6 +1446,12 @@ typedef struct alarm_event_t
    */
   size_t          attr_cnt;
   /** Array of event attributes.
+   *
+   * The array is kept sorted by attr_name, and lookups use
+   * binary search. Iterating it yields the attributes in name
+   * order, not in the order they were added. Code that fills
+   * the array directly must keep it sorted, or use the
+   * functions below instead.
    *
    * See also:
    * - #alarm_event_add_attr()
@@ -1458,6 +1465,7 @@ typedef struct alarm_event_t
    * - #alarm_event_get_attr_time()
    * - #alarm_event_set_attr_time()
    * - #alarm_event_del_attrs()
+   * - #alarm_event_set_attrs()
    */
   alarm_attr_t  **attr_tab;
 
@@ -1873,6 +1881,22 @@ int             alarm_event_has_attr            (alarm_event_t *self, const char
  */
 alarm_attr_t   *alarm_event_add_attr            (alarm_event_t *self, const char *name);
 
+/** \brief Sets several attributes of alarm event object at once
+ *
+ * Equivalent to setting each of the given attributes
+ * by name, but the attribute table is grown and sorted
+ * only once. Existing attributes with the same name are
+ * converted to the type and value given. If the same
+ * name occurs more than once, the last one is used.
+ *
+ * @since v1.1.24
+ *
+ * @param self  : alarm_event_t pointer
+ * @param attrs : array of attributes to copy from
+ * @param count : number of attributes
+ */
+void            alarm_event_set_attrs           (alarm_event_t *self, const alarm_attr_t *attrs, size_t count);
+
 /** \brief Adds named integer attribute to alarm event object
  *
  * If attribute with the same name already exists, it
@@ -2039,6 +2063,60 @@ int alarmd_event_del(cookie_t cookie);
  **/
 cookie_t alarmd_event_update(const alarm_event_t *event);
 
+/** \brief Adds several events to the alarm queue.
+ *
+ * @since v1.1.24
+ *
+ * Like calling alarmd_event_add() for each event, but uses
+ * only one dbus transaction and alarmd re-evaluates the
+ * queue only once. Nothing is sent to alarmd if any of
+ * the events is not sane.
+ *
+ * The event attribute tables are always sent, so the
+ * events can be handled only by alarmd >= v1.1.24.
+ *
+ * @param events  : array of alarm_event_t pointers
+ * @param count   : number of events
+ * @param cookies : array of count cookies to fill in,
+ *                  zero for events that were not added
+ *
+ * @returns error : 0 = no error, -1 = error
+ **/
+int alarmd_event_add_many(alarm_event_t * const *events, int count,
+                          cookie_t *cookies);
+
+/** \brief Updates several events already in the alarm queue.
+ *
+ * @since v1.1.24
+ *
+ * Like calling alarmd_event_update() for each event, but uses
+ * only one dbus transaction and alarmd re-evaluates the
+ * queue only once.
+ *
+ * @param events  : array of alarm_event_t pointers
+ * @param count   : number of events
+ * @param cookies : array of count cookies to fill in,
+ *                  zero for events that were not added
+ *
+ * @returns error : 0 = no error, -1 = error
+ **/
+int alarmd_event_update_many(alarm_event_t * const *events, int count,
+                             cookie_t *cookies);
+
+/** \brief Deletes several alarms from the alarm queue.
+ *
+ * @since v1.1.24
+ *
+ * Like calling alarmd_event_del() for each cookie, but uses
+ * only one dbus transaction.
+ *
+ * @param cookies : array of unique alarm event identifiers
+ * @param count   : number of cookies
+ *
+ * @returns deleted : number of alarms removed, or -1 on error
+ **/
+int alarmd_event_del_many(const cookie_t *cookies, int count);
+
 /** \brief Queries alarms in given time span.
  *
  * Finds every alarm whose _next_ occurence time is between first and last.
@@ -2068,6 +2146,39 @@ cookie_t *alarmd_event_query(const time_t first, const time_t last,
                              int32_t flag_mask, int32_t flags,
                              const char *appid);
 
+/** \brief Queries alarms in given time span, returns full events.
+ *
+ * @since v1.1.24
+ *
+ * Uses the same filters as alarmd_event_query(), but returns the
+ * events instead of cookies, so there is no need to call
+ * alarmd_event_get() for each of them.
+ *
+ * The events are in ascending trigger time order. For paging
+ * through large result sets, offset number of matches are
+ * skipped and at most limit events returned. Getting less than
+ * limit events means that there are no more matches.
+ *
+ * Use alarm_event_delete() to release each event, and free() to
+ * release the returned array.
+ *
+ * @param first      : start of time span (inclusive)
+ * @param last       : end of time span (inclusive)
+ * @param flag_mask  : Mask describing which flags you're interested in.
+ *                     Pass 0 to get all events.
+ * @param flags      : Values for the flags you're querying.
+ * @param appid      : Name of application, or NULL for all
+ * @param offset     : number of matching events to skip
+ * @param limit      : max number of events to return, 0 = no limit
+ *
+ * @returns events   : NULL terminated array of alarm_event_t pointers,
+ *                     or NULL on error
+ **/
+alarm_event_t **alarmd_event_query_full(const time_t first, const time_t last,
+                                        int32_t flag_mask, int32_t flags,
+                                        const char *appid,
+                                        unsigned offset, unsigned limit);
+
 /** \brief Fetches alarm defails.
  *
  * Finds an alarm with given identifier and returns alarm_event_t struct
@@ -0,0 +1,222 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+#include "alarmd_config.h"
+
+#include "pool.h"
+#include "libalarm.h"
+#include "logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ========================================================================= *
+ * pool_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * pool_alloc  --  get zero filled item, from free list if possible
+ * ------------------------------------------------------------------------- */
+
+void *
+pool_alloc(pool_t *self)
+{
+  void *item = self->po_free;
+
+  if( self->po_limit == 0 )
+  {
+    return calloc(1, self->po_size);
+  }
+
+  if( item != 0 )
+  {
+    self->po_free    = *(void **)item;
+    self->po_cached -= 1;
+    self->po_hits   += 1;
+    return memset(item, 0, self->po_size);
+  }
+
+  self->po_misses += 1;
+  return calloc(1, self->po_size);
+}
+
+/* ------------------------------------------------------------------------- *
+ * pool_release  --  put item to free list, or free it if the list is full
+ * ------------------------------------------------------------------------- */
+
+void
+pool_release(pool_t *self, void *item)
+{
+  if( item == 0 )
+  {
+    return;
+  }
+
+  if( self->po_cached >= self->po_limit )
+  {
+    if( self->po_limit != 0 )
+    {
+      self->po_drops += 1;
+    }
+    free(item);
+    return;
+  }
+
+  *(void **)item   = self->po_free;
+  self->po_free    = item;
+  self->po_cached += 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * pool_flush  --  release all cached items back to heap
+ * ------------------------------------------------------------------------- */
+
+void
+pool_flush(pool_t *self)
+{
+  for( void *item; (item = self->po_free) != 0; )
+  {
+    self->po_free = *(void **)item;
+    free(item);
+  }
+  self->po_cached = 0;
+}
+
+/* ========================================================================= *
+ * libalarm object pools
+ * ========================================================================= */
+
+#define POOL_INIT(NAME,TYPE,COUNT) { .po_name = NAME, .po_size = (COUNT) * sizeof(TYPE) }
+
+pool_t pool_event = POOL_INIT("event", alarm_event_t, 1);
+pool_t pool_attr  = POOL_INIT("attr",  alarm_attr_t,  1);
+
+pool_t pool_action[POOL_TABLE_MAX] =
+{
+  POOL_INIT("action1", alarm_action_t, 1),
+  POOL_INIT("action2", alarm_action_t, 2),
+  POOL_INIT("action3", alarm_action_t, 3),
+  POOL_INIT("action4", alarm_action_t, 4),
+};
+
+pool_t pool_recur[POOL_TABLE_MAX] =
+{
+  POOL_INIT("recur1", alarm_recur_t, 1),
+  POOL_INIT("recur2", alarm_recur_t, 2),
+  POOL_INIT("recur3", alarm_recur_t, 3),
+  POOL_INIT("recur4", alarm_recur_t, 4),
+};
+
+static pool_t * const pool_all[] =
+{
+  &pool_event,
+  &pool_attr,
+  &pool_action[0], &pool_action[1], &pool_action[2], &pool_action[3],
+  &pool_recur[0],  &pool_recur[1],  &pool_recur[2],  &pool_recur[3],
+};
+
+#define POOL_ALL_CNT (sizeof pool_all / sizeof *pool_all)
+
+/* ------------------------------------------------------------------------- *
+ * pool_table_alloc  --  get zero filled table of count entries
+ * ------------------------------------------------------------------------- */
+
+void *
+pool_table_alloc(pool_t *tab, size_t count, size_t size)
+{
+  if( count == 0 || count > POOL_TABLE_MAX )
+  {
+    return calloc(count, size);
+  }
+  return pool_alloc(&tab[count-1]);
+}
+
+/* ------------------------------------------------------------------------- *
+ * pool_table_release  --  release table of count entries
+ * ------------------------------------------------------------------------- */
+
+void
+pool_table_release(pool_t *tab, size_t count, void *table)
+{
+  /* tables grown with realloc() are at least count entries
+   * in size, so they can be reused for count entries */
+
+  if( count == 0 || count > POOL_TABLE_MAX )
+  {
+    free(table);
+  }
+  else
+  {
+    pool_release(&tab[count-1], table);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * pool_enable  --  start keeping released items for reuse
+ * ------------------------------------------------------------------------- */
+
+void
+pool_enable(size_t limit)
+{
+  for( size_t i = 0; i < POOL_ALL_CNT; ++i )
+  {
+    pool_all[i]->po_limit = limit;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * pool_disable  --  free cached items, back to plain heap allocations
+ * ------------------------------------------------------------------------- */
+
+void
+pool_disable(void)
+{
+  for( size_t i = 0; i < POOL_ALL_CNT; ++i )
+  {
+    pool_flush(pool_all[i]);
+    pool_all[i]->po_limit = 0;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * pool_log_stats  --  log hit / miss counters
+ * ------------------------------------------------------------------------- */
+
+void
+pool_log_stats(void)
+{
+  for( size_t i = 0; i < POOL_ALL_CNT; ++i )
+  {
+    const pool_t *p = pool_all[i];
+
+    if( p->po_hits + p->po_misses == 0 )
+    {
+      continue;
+    }
+
+    log_info("pool %-8s: %lu hits, %lu misses, %lu drops, %zu cached\n",
+             p->po_name, p->po_hits, p->po_misses, p->po_drops,
+             p->po_cached);
+  }
+}
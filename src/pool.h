@@ -0,0 +1,93 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#elif 0
+} /* fool JED indentation ... */
+#endif
+
+typedef struct pool_t pool_t;
+
+/* ------------------------------------------------------------------------- *
+ * pool_t
+ * ------------------------------------------------------------------------- */
+
+/* Free list of fixed size items. Released items are kept for reuse
+ * instead of being handed back to the heap. Every item is an
+ * ordinary malloc() block, so memory from a pool can still be passed
+ * to free() / realloc() and vice versa.
+ *
+ * Pools are disabled by default and libalarm client applications
+ * see plain calloc() / free(). Alarmd enables them at startup. */
+
+struct pool_t
+{
+  const char   *po_name;
+  size_t        po_size;    // bytes per item
+  size_t        po_limit;   // max items on free list, 0 = disabled
+  size_t        po_cached;  // items on free list
+  void         *po_free;    // free list
+
+  unsigned long po_hits;    // allocations served from free list
+  unsigned long po_misses;  // allocations that went to heap
+  unsigned long po_drops;   // releases that went to heap
+};
+
+void  *pool_alloc        (pool_t *self);
+void   pool_release      (pool_t *self, void *item);
+void   pool_flush        (pool_t *self);
+
+/* ------------------------------------------------------------------------- *
+ * libalarm object pools
+ * ------------------------------------------------------------------------- */
+
+/* action and recurrence tables with up to this many entries are pooled */
+#define POOL_TABLE_MAX 4
+
+/* default free list length used by alarmd */
+#define POOL_LIMIT_DEFAULT 64
+
+extern pool_t pool_event;
+extern pool_t pool_attr;
+extern pool_t pool_action[POOL_TABLE_MAX];
+extern pool_t pool_recur[POOL_TABLE_MAX];
+
+void  *pool_table_alloc  (pool_t *tab, size_t count, size_t size);
+void   pool_table_release(pool_t *tab, size_t count, void *table);
+
+void   pool_enable       (size_t limit);
+void   pool_disable      (void);
+void   pool_log_stats    (void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* POOL_H_ */
@@ -28,12 +28,17 @@
 #include "logging.h"
 #include "inifile.h"
 #include "ticker.h"
+#include "unique.h"
+#include "pool.h"
 
 #include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sys/inotify.h>
 
 /* ========================================================================= *
  * CONSTANTS
@@ -46,6 +51,23 @@
 #define QUEUE_DATABASE    ALARMD_CONFIG_CACHEDIR"/alarm_queue.ini"
 #define QUEUE_BACKUP      QUEUE_DATABASE".bak"
 #define QUEUE_TEMPSAVE    QUEUE_DATABASE".tmp"
+#define QUEUE_JOURNAL     ALARMD_CONFIG_CACHEDIR"/alarm_queue.jnl"
+#define QUEUE_BINARY      ALARMD_CONFIG_CACHEDIR"/alarm_queue.bin"
+#define QUEUE_BINTEMP     QUEUE_BINARY".tmp"
+
+/* ------------------------------------------------------------------------- *
+ * binary snapshot format identification
+ * ------------------------------------------------------------------------- */
+
+#define QUEUE_BINARY_MAGIC     "ALRMQBIN"
+#define QUEUE_BINARY_VERSION   2
+
+/* ------------------------------------------------------------------------- *
+ * journal settings
+ * ------------------------------------------------------------------------- */
+
+/* journal size that triggers writing a new snapshot */
+#define QUEUE_JOURNAL_LIMIT    (32 * 1024)
 
 /* ------------------------------------------------------------------------- *
  * default settings
@@ -63,38 +85,304 @@ const char * const queue_event_state_names[] =
 #include "states.inc"
 };
 
+#define QUEUE_STATE_COUNT (sizeof queue_event_state_names /\
+                           sizeof *queue_event_state_names)
+
 /* ========================================================================= *
  * INTERNAL STATE DATA
  * ========================================================================= */
 
-/* current default snooze period, used for events that do
- * not specify custom snooze */
-static unsigned        queue_snooze = QUEUE_SNOOZE_DEFAULT;
+/* queue bookkeeping data attached to each active event */
+typedef struct queue_node_t queue_node_t;
 
-/* highest cookie currently in use */
-static cookie_t        queue_cookie = 0;
+/* events belonging to one application */
+typedef struct queue_app_t queue_app_t;
 
-/* queue out of sync with persistent storage flag */
-static int             queue_dirty  = 0;
+struct queue_node_t
+{
+  /* the event itself */
+  alarm_event_t *qn_event;
+
+  /* back-pointer: slot in the trigger heap */
+  size_t         qn_heap;
+
+  /* links in the list of events in the same state */
+  queue_node_t  *qn_prev;
+  queue_node_t  *qn_next;
+
+  /* iteration stamp, see queue_iter_first() */
+  unsigned       qn_stamp;
+
+  /* already in the list of touched events */
+  int            qn_touched;
+
+  /* record types waiting to be written to journal */
+  unsigned       qn_journal;
+
+  /* application group and slot within it */
+  queue_app_t   *qn_app;
+  size_t         qn_app_slot;
+
+  /* event flags as accounted for in queue statistics */
+  unsigned       qn_counted;
+
+  /* cached ini text of the event, see queue_node_get_text() */
+  char          *qn_text;
+  size_t         qn_text_size;
+  uint64_t       qn_text_hash;
+  int            qn_text_ok;
+
+  /* event body in binary snapshot mapping, not decoded yet;
+   * see queue_node_unpack() */
+  const char    *qn_body;
+  size_t         qn_body_size;
+
+  /* single allocation holding the event tables and
+   * private strings; see queue_event_flatten() */
+  char          *qn_block;
+  size_t         qn_block_size;
+};
+
+struct queue_app_t
+{
+  /* alarm_appid shared by the group members, pooled string */
+  char          *qa_appid;
+
+  /* member nodes in no particular order */
+  queue_node_t **qa_node;
+  size_t         qa_count;
+  size_t         qa_alloc;
+
+  /* member events in ascending trigger order, built on demand */
+  alarm_event_t **qa_order;
+  int            qa_order_ok;
+};
+
+/* file writes handed over to the background writer */
+typedef struct queue_write_t queue_write_t;
+
+struct queue_write_t
+{
+  /* snapshot ini text and binary image, null for journal appends */
+  char          *qw_ini;
+  size_t         qw_ini_size;
+  char          *qw_bin;
+  size_t         qw_bin_size;
+
+  /* journal records, replace the journal file if qw_reset is set */
+  char          *qw_jnl;
+  size_t         qw_jnl_size;
+  int            qw_reset;
+
+  /* content hash of the snapshot, see queue_save_to_memory() */
+  uint64_t       qw_hash;
+
+  /* outcome: -1=failed, 0=journal restarted, 1=saved, 2=journaled */
+  int            qw_result;
+  int            qw_ini_ok;
+  struct stat    qw_stat;
+
+  /* next finished write */
+  queue_write_t *qw_next;
+};
 
-/* active events - ordered by event cookie
+/* journal record types */
+enum
+{
+  QUEUE_JREC_HEAD,    // value: snapshot generation
+  QUEUE_JREC_ADD,     // payload: event in ini format
+  QUEUE_JREC_UPDATE,  // payload: event in ini format
+  QUEUE_JREC_DELETE,  // cookie only
+  QUEUE_JREC_STATE,   // value: event flags
+  QUEUE_JREC_TRIGGER, // value: event trigger
+  QUEUE_JREC_CONFIG,  // value: default snooze
+};
+
+/* journal record header, followed by qj_size bytes of payload
+ *
+ * the crc covers the header fields after it and the payload */
+typedef struct
+{
+  uint32_t       qj_crc;
+  uint32_t       qj_type;
+  uint32_t       qj_cookie;
+  uint32_t       qj_size;
+  int64_t        qj_value;
+} queue_jrec_t;
+
+/* binary snapshot header, followed by qb_size bytes of event data
  *
- * ascending cookie sort: older alarms first */
-static alarm_event_t **queue_by_cookie  = 0;
+ * the snapshot is derived from the ini file it was written with
+ * and is used only while size and mtime of the ini file match */
+typedef struct
+{
+  char           qb_magic[8];
+  uint32_t       qb_version;
+  uint32_t       qb_crc;
+  uint32_t       qb_size;
+  uint32_t       qb_count;
+  uint32_t       qb_gen;
+  uint32_t       qb_snooze;
+  int64_t        qb_ini_size;
+  int64_t        qb_ini_mtime;
+} queue_bin_t;
+
+/* read position in binary snapshot data */
+typedef struct
+{
+  const char    *qr_pos;
+  const char    *qr_end;
+  int            qr_err;
+} queue_rd_t;
+
+/* entry in the list of touched events */
+typedef struct
+{
+  cookie_t       qt_cookie;
+  unsigned       qt_state;
+} queue_touch_t;
+
+/* cookie lookup table slot */
+typedef struct
+{
+  cookie_t      qh_cookie;
+  queue_node_t *qh_node;
+} queue_hash_t;
 
-/* active events - ordered by event trigger
+/* queue content: the events and everything indexing them
  *
- * descending trigger sort: the first to trigger
- * is the last in the queue -> updating trigger
- * values (due to snooze etc) is more likely to
- * affect only the tail of the queue */
-static alarm_event_t **queue_by_trigger = 0;
+ * the daemon works on queue_main; a queue file can be loaded
+ * into a separate context, e.g. for comparing it against the
+ * live queue, see queue_merge_from_path() */
+typedef struct
+{
+  /* current default snooze period, used for events that do
+   * not specify custom snooze */
+  unsigned        qc_snooze;
+
+  /* highest cookie currently in use */
+  cookie_t        qc_cookie;
+
+  /* active events - open addressing hash table keyed by cookie
+   *
+   * linear probing, table size is a power of two and kept
+   * at least twice the number of events */
+  queue_hash_t   *qc_by_cookie;
+
+  /* number of slots in cookie lookup table */
+  size_t          qc_hash_size;
+
+  /* active events - binary min-heap keyed by event trigger
+   *
+   * the first to trigger is always at slot zero, each
+   * node knows its heap slot -> adding, removing and
+   * updating trigger values are O(log N) operations */
+  queue_node_t  **qc_by_trigger;
+
+  /* active events - in ascending trigger order
+   *
+   * built on demand from the trigger heap for queries
+   * that need to see the events in order, invalidated
+   * whenever event triggers or the queue content changes */
+  alarm_event_t **qc_by_order;
+  int             qc_order_ok;
+
+  /* active events - grouped by alarm_appid
+   *
+   * groups are kept sorted by appid so that the group for
+   * an application can be found with binary search, empty
+   * groups are released as soon as the last event leaves */
+  queue_app_t   **qc_by_app;
+  size_t          qc_app_count;
+  size_t          qc_app_alloc;
+
+  /* active events - one circular list per event state
+   *
+   * nodes are moved from list to list by queue_event_set_state()
+   * so that the server side state machine can process events in
+   * one state without scanning through the whole queue */
+  queue_node_t    qc_by_state[QUEUE_STATE_COUNT];
+
+  /* number of events in each state list */
+  size_t          qc_state_count[QUEUE_STATE_COUNT];
+
+  /* number of enabled events in each state, and in each
+   * state with given client flag bit set
+   *
+   * kept up to date as events enter and leave the queue,
+   * change state or get modified -> counting is O(1) */
+  int             qc_stat_state[QUEUE_STATE_COUNT];
+  int             qc_stat_flag[QUEUE_STATE_COUNT][ALARM_EVENT_CLIENT_BITS];
+
+  /* events that have changed state or trigger time since the
+   * list was last cleared, and the state they were in then */
+  queue_touch_t  *qc_touched;
+  size_t          qc_touched_cnt;
+  size_t          qc_touched_alloc;
+
+  /* number of active events */
+  size_t          qc_count;
+
+  /* number of slots available in trigger tables */
+  size_t          qc_alloc;
+
+  /* generation of the snapshot the journal file applies to */
+  unsigned        qc_journal_gen;
+
+  /* journal file is in sync with snapshot and can be appended */
+  int             qc_journal_ok;
+
+  /* current size of the journal file */
+  size_t          qc_journal_size;
 
-/* number of active events */
-static size_t          queue_count      = 0;
+  /* default snooze changed since last save */
+  int             qc_journal_config;
 
-/* number of slots available in queue tables */
-static size_t          queue_alloc      = 0;
+  /* cookies of events with pending journal records, in the
+   * order they were first changed since the last save */
+  cookie_t       *qc_pending;
+  size_t          qc_pending_cnt;
+  size_t          qc_pending_alloc;
+} queue_ctx_t;
+
+/* the live queue, and the context the queue functions work on */
+static queue_ctx_t     queue_main =
+{
+  .qc_snooze = QUEUE_SNOOZE_DEFAULT,
+};
+static queue_ctx_t    *queue = &queue_main;
+
+/* queue out of sync with persistent storage flag */
+static int             queue_dirty  = 0;
+
+/* queue save statistics */
+static unsigned        queue_stat_saved     = 0;
+static unsigned        queue_stat_journaled = 0;
+static unsigned        queue_stat_skipped   = 0;
+static unsigned        queue_stat_failed    = 0;
+
+/* latest iteration stamp handed out */
+static unsigned        queue_iter_stamp = 0;
+
+/* number of events handed out via iterators & touched list */
+static unsigned        queue_visited    = 0;
+
+/* content hash of the last snapshot written, valid while the
+ * snapshot file stays as it was after writing */
+static uint64_t        queue_snap_hash      = 0;
+static int             queue_snap_ok        = 0;
+static struct stat     queue_snap_stat;
+
+/* binary snapshot mapping that undecoded event bodies point
+ * into; unmapped when the last of them has been decoded */
+static void           *queue_bin_map        = 0;
+static size_t          queue_bin_map_size   = 0;
+static size_t          queue_bin_map_refs   = 0;
+
+/* events replaced while merging external queue file changes
+ * that system ui may still be showing dialogs for */
+static cookie_t       *queue_replaced      = 0;
+static int             queue_replaced_cnt  = 0;
 
 /* stats of the queue file - used for detecting whend somebody
  * else than alarmd has modified the queue file since the last
@@ -105,6 +393,33 @@ static struct stat     queue_save_stat;
  * file modification is detected */
 static void (*queue_modified_cb)(void) = 0;
 
+/* background writer thread; one write can be in progress while
+ * the next one waits, later saves are merged to the waiting one */
+static pthread_t        queue_writer_tid;
+static int              queue_writer_running = 0;
+static int              queue_writer_quit    = 0;
+static pthread_mutex_t  queue_writer_mutex   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   queue_writer_cond    = PTHREAD_COND_INITIALIZER;
+static queue_write_t   *queue_writer_busy    = 0;
+static queue_write_t   *queue_writer_next    = 0;
+static queue_write_t   *queue_writer_done    = 0;
+
+/* journal file is missing records after a failed write; only
+ * accessed by whoever executes the writes */
+static int              queue_writer_broken  = 0;
+
+/* writes handed over but not yet collected by the mainloop */
+static size_t           queue_writer_jobs    = 0;
+
+/* callback function: called from the writer
+ * thread when a write has been finished */
+static void (*queue_saved_cb)(void) = 0;
+
+/* inotify descriptor watching the cache directory, and a flag
+ * for deferring the check until own writes have finished */
+static int              queue_watch_fd       = -1;
+static int              queue_watch_pending  = 0;
+
 /* ========================================================================= *
  * COMPARE OPERATORS
  * ========================================================================= */
@@ -156,1063 +471,4337 @@ static
 int
 queue_cmp_event_trigger(const alarm_event_t *a, const alarm_event_t *b)
 {
-  // trigger table in descending order:
-  // - next to trigger last
-  // - "oldest" (by cookie) at the same time last
+  // trigger order is ascending:
+  // - next to trigger first
+  // - "oldest" (by cookie) at the same time first
 
   time_t ta = alarm_event_get_trigger(a);
   time_t tb = alarm_event_get_trigger(b);
-  return queue_cmp_trigger(tb, ta) ?: queue_cmp_event_cookie(b,a);
+  return queue_cmp_trigger(ta, tb) ?: queue_cmp_event_cookie(a,b);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_cmp_event_cookie_cb  --  qsort compatible queue_cmp_event_cookie
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_cmp_event_cookie_cb(const void *a, const void *b)
+{
+  return queue_cmp_event_cookie(*(const alarm_event_t * const *)a,
+                                *(const alarm_event_t * const *)b);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_cmp_event_trigger_cb  --  qsort compatible queue_cmp_event_trigger
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_cmp_event_trigger_cb(const void *a, const void *b)
+{
+  return queue_cmp_event_trigger(*(const alarm_event_t * const *)a,
+                                 *(const alarm_event_t * const *)b);
 }
 
 #undef CMP
 
 /* ========================================================================= *
- * INTERNAL FUNCTIONALITY
+ * TRIGGER HEAP
  * ========================================================================= */
 
 /* ------------------------------------------------------------------------- *
- * queue_get_trigger_slot  --  find event slot in trigger ordered table
+ * queue_heap_less  --  heap ordering predicate
+ * ------------------------------------------------------------------------- */
+
+static inline
+int
+queue_heap_less(const queue_node_t *a, const queue_node_t *b)
+{
+  return queue_cmp_event_trigger(a->qn_event, b->qn_event) < 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_heap_place  --  store node to heap slot, update back-pointer
+ * ------------------------------------------------------------------------- */
+
+static inline
+void
+queue_heap_place(queue_node_t *node, size_t slot)
+{
+  queue->qc_by_trigger[slot] = node, node->qn_heap = slot;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_heap_sift_up  --  move node towards the heap root
  * ------------------------------------------------------------------------- */
 
-static size_t queue_get_trigger_slot(alarm_event_t *eve)
+static
+size_t
+queue_heap_sift_up(size_t slot)
 {
-  size_t l,h,i;
+  queue_node_t *node = queue->qc_by_trigger[slot];
 
-  for( l = 0, h = queue_count; l < h; )
+  while( slot > 0 )
   {
-    if( queue_cmp_event_trigger(queue_by_trigger[(i = (l+h)/2)], eve) < 0 )
-    {
-      l = i + 1;
-    }
-    else
+    size_t parent = (slot - 1) / 2;
+
+    if( !queue_heap_less(node, queue->qc_by_trigger[parent]) )
     {
-      h = i + 0;
+      break;
     }
+    queue_heap_place(queue->qc_by_trigger[parent], slot);
+    slot = parent;
   }
-  assert( l == h );
-  return l;
+  queue_heap_place(node, slot);
+  return slot;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_get_cookie_slot  --  find event slot in cookie ordered table
+ * queue_heap_sift_down  --  move node towards the heap leaves
  * ------------------------------------------------------------------------- */
 
-static size_t queue_get_cookie_slot(alarm_event_t *eve)
+static
+size_t
+queue_heap_sift_down(size_t slot)
 {
-  size_t l,h,i;
+  queue_node_t *node = queue->qc_by_trigger[slot];
 
-  for( l = 0, h = queue_count; l < h; )
+  for( ;; )
   {
-    if( queue_cmp_event_cookie(queue_by_cookie[(i = (l+h)/2)], eve) < 0 )
+    size_t child = 2 * slot + 1;
+
+    if( child >= queue->qc_count )
     {
-      l = i + 1;
+      break;
     }
-    else
+    if( child + 1 < queue->qc_count &&
+        queue_heap_less(queue->qc_by_trigger[child+1], queue->qc_by_trigger[child]) )
+    {
+      child += 1;
+    }
+    if( !queue_heap_less(queue->qc_by_trigger[child], node) )
     {
-      h = i + 0;
+      break;
     }
+    queue_heap_place(queue->qc_by_trigger[child], slot);
+    slot = child;
   }
-  assert( l == h );
-  return l;
+  queue_heap_place(node, slot);
+  return slot;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_insert_event
+ * queue_heap_update  --  restore heap order after node key change
  * ------------------------------------------------------------------------- */
 
 static
 void
-queue_insert_event(alarm_event_t *eve)
+queue_heap_update(size_t slot)
 {
-  if( queue_count == queue_alloc )
+  if( queue_heap_sift_up(slot) == slot )
   {
-    queue_alloc += 32;
-
-    queue_by_cookie  = realloc(queue_by_cookie,
-                               queue_alloc * sizeof *queue_by_cookie);
-    queue_by_trigger = realloc(queue_by_trigger,
-                               queue_alloc * sizeof *queue_by_trigger);
+    queue_heap_sift_down(slot);
   }
+}
 
-  size_t t = queue_get_trigger_slot(eve);
-  size_t c = queue_get_cookie_slot(eve);
-
-  assert( (t == queue_count) || (queue_by_trigger[t] != eve) );
-  assert( (c == queue_count) || (queue_by_cookie[c]  != eve) );
+/* ------------------------------------------------------------------------- *
+ * queue_heap_build  --  heapify the first qc_count nodes
+ * ------------------------------------------------------------------------- */
 
-  for( size_t i = queue_count; i > t; --i )
+static
+void
+queue_heap_build(void)
+{
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    queue->qc_by_trigger[i]->qn_heap = i;
+  }
+  for( size_t i = queue->qc_count / 2; i--; )
   {
-    queue_by_trigger[i] = queue_by_trigger[i-1];
+    queue_heap_sift_down(i);
   }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_heap_remove  --  take node out of the heap
+ * ------------------------------------------------------------------------- */
 
-  for( size_t i = queue_count; i > c; --i )
+static
+void
+queue_heap_remove(size_t slot)
+{
+  if( slot < --queue->qc_count )
   {
-    queue_by_cookie[i] = queue_by_cookie[i-1];
+    queue_heap_place(queue->qc_by_trigger[queue->qc_count], slot);
+    queue_heap_update(slot);
   }
+}
 
-  queue_by_trigger[t] = eve;
-  queue_by_cookie[c]  = eve;
-  queue_count += 1;
+/* ------------------------------------------------------------------------- *
+ * queue_heap_peek  --  get the next event to trigger
+ * ------------------------------------------------------------------------- */
 
-  queue_set_dirty();
+static inline
+alarm_event_t *
+queue_heap_peek(void)
+{
+  return queue->qc_count ? queue->qc_by_trigger[0]->qn_event : 0;
 }
 
 /* ========================================================================= *
- * INDICATION INTERFACE
+ * COOKIE LOOKUP TABLE
  * ========================================================================= */
 
 /* ------------------------------------------------------------------------- *
- * queue_set_modified_cb
+ * queue_hash_slot  --  get preferred lookup table slot for cookie
  * ------------------------------------------------------------------------- */
 
-void queue_set_modified_cb(void (*cb)(void))
+static inline
+size_t
+queue_hash_slot(cookie_t cookie)
 {
-  queue_modified_cb = cb;
+  /* cookies are sequential -> multiplicative hashing
+   * spreads them evenly over the table */
+  return ((uint32_t)cookie * 2654435761u) & (queue->qc_hash_size - 1);
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_indicate_modified
+ * queue_hash_put  --  add node to lookup table without resizing
  * ------------------------------------------------------------------------- */
 
-static void queue_indicate_modified(void)
+static
+void
+queue_hash_put(queue_node_t *node)
 {
-  if( queue_modified_cb != 0 )
+  cookie_t cookie = node->qn_event->ALARMD_PRIVATE(cookie);
+  size_t   i      = queue_hash_slot(cookie);
+
+  while( queue->qc_by_cookie[i].qh_node != 0 )
   {
-    queue_modified_cb();
+    i = (i + 1) & (queue->qc_hash_size - 1);
   }
+  queue->qc_by_cookie[i].qh_cookie = cookie;
+  queue->qc_by_cookie[i].qh_node   = node;
 }
 
-/* ========================================================================= *
- * SETTINGS INTERFACE
- * ========================================================================= */
-
 /* ------------------------------------------------------------------------- *
- * queue_get_snooze
+ * queue_hash_resize  --  rehash lookup table to a new size
  * ------------------------------------------------------------------------- */
 
-unsigned
-queue_get_snooze(void)
+static
+void
+queue_hash_resize(size_t size)
 {
-  return queue_snooze;
+  queue_hash_t *old = queue->qc_by_cookie;
+  size_t        cnt = queue->qc_hash_size;
+
+  queue->qc_by_cookie = calloc(size, sizeof *queue->qc_by_cookie);
+  queue->qc_hash_size = size;
+
+  for( size_t i = 0; i < cnt; ++i )
+  {
+    if( old[i].qh_node != 0 )
+    {
+      queue_hash_put(old[i].qh_node);
+    }
+  }
+  free(old);
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_set_snooze
+ * queue_hash_add  --  add node to lookup table
  * ------------------------------------------------------------------------- */
 
+static
 void
-queue_set_snooze(unsigned snooze)
+queue_hash_add(queue_node_t *node)
 {
-  if( snooze < 1 || snooze > 24*60*60 )
+  if( 2 * (queue->qc_count + 1) > queue->qc_hash_size )
   {
-    snooze = QUEUE_SNOOZE_DEFAULT;
+    queue_hash_resize(queue->qc_hash_size ? 2 * queue->qc_hash_size : 64);
   }
-  queue_snooze = snooze;
-  queue_set_dirty();
+  queue_hash_put(node);
 }
 
-/* ========================================================================= *
- * EVENT INTERFACE
- * ========================================================================= */
-
 /* ------------------------------------------------------------------------- *
- * queue_event_set_trigger
+ * queue_hash_remove  --  remove node from lookup table
  * ------------------------------------------------------------------------- */
 
+static
 void
-queue_event_set_trigger(alarm_event_t *event, time_t trigger)
+queue_hash_remove(queue_node_t *node)
 {
-  log_info("[%ld] SET TRIGGER: %s (T%s)\n",
-           (long)alarm_event_get_cookie(event),
-           ticker_date_format_long(0,0,trigger),
-           ticker_secs_format(0,0,ticker_get_time()-trigger));
+  size_t mask = queue->qc_hash_size - 1;
+  size_t i    = queue_hash_slot(node->qn_event->ALARMD_PRIVATE(cookie));
 
-  size_t ti, to;
+  for( ; queue->qc_by_cookie[i].qh_node != node; i = (i + 1) & mask )
+  {
+    assert( queue->qc_by_cookie[i].qh_node != 0 );
+  }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * get slot indices for old and updated
-   * trigger values
-   * - - - - - - - - - - - - - - - - - - - */
+  /* backward shift deletion: move entries that would
+   * become unreachable over the freed slot, so that no
+   * tombstone markers are needed */
 
-  alarm_event_t temp = {
-    .ALARMD_PRIVATE(cookie) = event->ALARMD_PRIVATE(cookie),
-    .ALARMD_PRIVATE(trigger) = trigger,
-  };
+  for( size_t j = i;; )
+  {
+    queue->qc_by_cookie[i].qh_node = 0;
 
-  ti = queue_get_trigger_slot(event);
-  to = queue_get_trigger_slot(&temp);
+    for( ;; )
+    {
+      j = (j + 1) & mask;
 
-  event->ALARMD_PRIVATE(trigger) = trigger;
+      if( queue->qc_by_cookie[j].qh_node == 0 )
+      {
+        return;
+      }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * how queue will be shifted depends on
-   * whether the updated position is before
-   * or after the original
-   * - - - - - - - - - - - - - - - - - - - */
+      size_t k = queue_hash_slot(queue->qc_by_cookie[j].qh_cookie);
+
+      /* entry at j can fill the hole at i unless its
+       * preferred slot k lies cyclically within (i, j] */
+      if( i <= j ? (i < k && k <= j) : (i < k || k <= j) )
+      {
+        continue;
+      }
+      break;
+    }
+
+    queue->qc_by_cookie[i] = queue->qc_by_cookie[j];
+    i = j;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_hash_lookup  --  find bookkeeping node for event cookie
+ * ------------------------------------------------------------------------- */
 
-  if( to <= ti )
+static
+queue_node_t *
+queue_hash_lookup(cookie_t cookie)
+{
+  if( queue->qc_hash_size != 0 )
   {
-    //  +---+---+---+---+---+---+---+---+
-    //  | A | B | C | X | D | E | F | G |
-    //  +---+---+---+---+---+---+---+---+
-    //      |to     |ti
-    //  +---+---+---+---+---+---+---+---+
-    //  | A | - | B | C | D | E | F | G |
-    //  +---+---+---+---+---+---+---+---+
-    //      |to     |ti
+    size_t mask = queue->qc_hash_size - 1;
 
-    for( ; ti > to; --ti )
+    for( size_t i = queue_hash_slot(cookie);
+         queue->qc_by_cookie[i].qh_node != 0; i = (i + 1) & mask )
     {
-      queue_by_trigger[ti] = queue_by_trigger[ti-1];
+      if( queue->qc_by_cookie[i].qh_cookie == cookie )
+      {
+        return queue->qc_by_cookie[i].qh_node;
+      }
     }
   }
-  else
+  return 0;
+}
+
+/* ========================================================================= *
+ * APPLICATION INDEX
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_app_search  --  binary search application group by appid
+ * ------------------------------------------------------------------------- */
+
+static
+queue_app_t *
+queue_app_search(const char *appid, size_t *ppos)
+{
+  size_t lo = 0, hi = queue->qc_app_count;
+
+  while( lo < hi )
   {
-    //  +---+---+---+---+---+---+---+---+
-    //  | A | B | C | X | D | E | F | G |
-    //  +---+---+---+---+---+---+---+---+
-    //              |ti         |to
-    //  +---+---+---+---+---+---+---+---+
-    //  | A | B | C | D | E | - | F | G |
-    //  +---+---+---+---+---+---+---+---+
-    //              |ti     |to
+    size_t i = lo + (hi - lo) / 2;
+    int    r = ((queue->qc_by_app[i]->qa_appid == appid) ? 0 :
+                strcmp(queue->qc_by_app[i]->qa_appid, appid));
 
-    for( --to; ti < to; ++ti )
+    if( r == 0 )
     {
-      queue_by_trigger[ti] = queue_by_trigger[ti+1];
+      lo = i;
+      break;
     }
+    if( r < 0 ) lo = i + 1; else hi = i;
   }
-  queue_by_trigger[to] = event;
 
-  queue_set_dirty();
+  if( ppos ) *ppos = lo;
+
+  if( lo < queue->qc_app_count && !strcmp(queue->qc_by_app[lo]->qa_appid, appid) )
+  {
+    return queue->qc_by_app[lo];
+  }
+  return 0;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_event_get_state
+ * queue_app_link  --  add node to the group of its application
  * ------------------------------------------------------------------------- */
 
-unsigned
-queue_event_get_state(const alarm_event_t *self)
+static
+void
+queue_app_link(queue_node_t *node)
 {
-  return self->flags >> ALARM_EVENT_CLIENT_BITS;
+  const char  *appid = node->qn_event->alarm_appid ?: "";
+  size_t       pos   = 0;
+  queue_app_t *app   = queue_app_search(appid, &pos);
+
+  if( app == 0 )
+  {
+    if( queue->qc_app_count == queue->qc_app_alloc )
+    {
+      queue->qc_app_alloc += 16;
+      queue->qc_by_app = realloc(queue->qc_by_app,
+                                 queue->qc_app_alloc * sizeof *queue->qc_by_app);
+    }
+    memmove(&queue->qc_by_app[pos+1], &queue->qc_by_app[pos],
+            (queue->qc_app_count - pos) * sizeof *queue->qc_by_app);
+    queue->qc_app_count += 1;
+
+    app = calloc(1, sizeof *app);
+    app->qa_appid = unique_intern(appid);
+    queue->qc_by_app[pos] = app;
+  }
+
+  if( app->qa_count == app->qa_alloc )
+  {
+    app->qa_alloc += 16;
+    app->qa_node  = realloc(app->qa_node,  app->qa_alloc * sizeof *app->qa_node);
+    app->qa_order = realloc(app->qa_order, app->qa_alloc * sizeof *app->qa_order);
+  }
+
+  node->qn_app      = app;
+  node->qn_app_slot = app->qa_count;
+  app->qa_node[app->qa_count++] = node;
+  app->qa_order_ok  = 0;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_event_set_state
+ * queue_app_delete  --  release application group
  * ------------------------------------------------------------------------- */
 
+static
 void
-queue_event_set_state(alarm_event_t *self, unsigned state)
+queue_app_delete(queue_app_t *app)
 {
-  unsigned previous = queue_event_get_state(self);
-  unsigned current  = previous;
+  unique_release(app->qa_appid);
+  free(app->qa_node);
+  free(app->qa_order);
+  free(app);
+}
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * do some filtering for state transitions
-   * occuring due to external events
-   * - - - - - - - - - - - - - - - - - - - */
+/* ------------------------------------------------------------------------- *
+ * queue_app_unlink  --  remove node from its application group
+ * ------------------------------------------------------------------------- */
 
-  switch( state )
+static
+void
+queue_app_unlink(queue_node_t *node)
+{
+  queue_app_t *app = node->qn_app;
+
+  if( app == 0 )
   {
-  default:
-    log_debug("UNKNOWN TRANSITION: %s -> %u\n",
-              queue_event_state_names[previous], state);
-    break;
+    return;
+  }
 
-  case ALARM_STATE_NEW:
-  case ALARM_STATE_WAITCONN:
-  case ALARM_STATE_QUEUED:
-  case ALARM_STATE_MISSED:
-  case ALARM_STATE_POSTPONED:
+  /* fill the hole with the last member */
+  queue_node_t *last = app->qa_node[--app->qa_count];
+  app->qa_node[node->qn_app_slot] = last;
+  last->qn_app_slot = node->qn_app_slot;
+  app->qa_order_ok  = 0;
 
-  case ALARM_STATE_LIMBO:
-  case ALARM_STATE_TRIGGERED:
-  case ALARM_STATE_WAITSYSUI:
-  case ALARM_STATE_SYSUI_REQ:
+  node->qn_app = 0;
 
-  case ALARM_STATE_SNOOZED:
-  case ALARM_STATE_SERVED:
-  case ALARM_STATE_RECURRING:
-  case ALARM_STATE_DELETED:
-  case ALARM_STATE_FINALIZED:
-    current = state;
-    break;
+  if( app->qa_count == 0 )
+  {
+    size_t pos = 0;
 
-  case ALARM_STATE_SYSUI_ACK:
-    switch( previous )
+    if( queue_app_search(app->qa_appid, &pos) == app )
     {
-    case ALARM_STATE_SYSUI_REQ:
-      current = state;
-      break;
+      queue->qc_app_count -= 1;
+      memmove(&queue->qc_by_app[pos], &queue->qc_by_app[pos+1],
+              (queue->qc_app_count - pos) * sizeof *queue->qc_by_app);
     }
-    break;
+    queue_app_delete(app);
+  }
+}
 
-  case ALARM_STATE_SYSUI_RSP:
-    switch( previous )
+/* ------------------------------------------------------------------------- *
+ * queue_app_get_trigger_order  --  get application events in trigger order
+ * ------------------------------------------------------------------------- */
+
+static
+alarm_event_t **
+queue_app_get_trigger_order(queue_app_t *app)
+{
+  if( !app->qa_order_ok )
+  {
+    for( size_t i = 0; i < app->qa_count; ++i )
     {
-    case ALARM_STATE_SYSUI_REQ:
-    case ALARM_STATE_SYSUI_ACK:
-      current = state;
-      break;
+      app->qa_order[i] = app->qa_node[i]->qn_event;
     }
-    break;
+    qsort(app->qa_order, app->qa_count, sizeof *app->qa_order,
+          queue_cmp_event_trigger_cb);
+
+    app->qa_order_ok = 1;
   }
+  return app->qa_order;
+}
 
-  if( previous != current )
+/* ------------------------------------------------------------------------- *
+ * queue_app_reset  --  release all application groups
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_app_reset(void)
+{
+  for( size_t i = 0; i < queue->qc_app_count; ++i )
   {
-    log_info("[%d] TRANS: %s -> %s\n",
-             self->ALARMD_PRIVATE(cookie),
-             queue_event_state_names[previous],
-             queue_event_state_names[current]);
+    queue_app_delete(queue->qc_by_app[i]);
+  }
+  free(queue->qc_by_app);
 
-    if( (current == ALARM_STATE_NEW) || (current < previous) )
+  queue->qc_by_app    = 0;
+  queue->qc_app_count = 0;
+  queue->qc_app_alloc = 0;
+}
+
+/* ========================================================================= *
+ * STATE LISTS
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_state_head  --  get list head for event state
+ * ------------------------------------------------------------------------- */
+
+static
+queue_node_t *
+queue_state_head(unsigned state)
+{
+  queue_node_t *head = &queue->qc_by_state[state];
+
+  if( head->qn_next == 0 )
+  {
+    head->qn_prev = head->qn_next = head;
+  }
+  return head;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_state_unlink  --  remove node from the state list it is in
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_state_unlink(queue_node_t *node, unsigned state)
+{
+  if( node->qn_next != 0 )
+  {
+    node->qn_prev->qn_next = node->qn_next;
+    node->qn_next->qn_prev = node->qn_prev;
+    node->qn_prev = node->qn_next = 0;
+    queue->qc_state_count[state] -= 1;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_state_link  --  append node to the tail of state list
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_state_link(queue_node_t *node, unsigned state)
+{
+  queue_node_t *head = queue_state_head(state);
+
+  node->qn_next = head;
+  node->qn_prev = head->qn_prev;
+  node->qn_prev->qn_next = node;
+  head->qn_prev = node;
+  node->qn_stamp = 0;
+  queue->qc_state_count[state] += 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_state_reset  --  forget all state list content
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_state_reset(void)
+{
+  for( size_t i = 0; i < QUEUE_STATE_COUNT; ++i )
+  {
+    queue->qc_by_state[i].qn_prev = queue->qc_by_state[i].qn_next = 0;
+    queue->qc_state_count[i] = 0;
+  }
+}
+
+/* ========================================================================= *
+ * EVENT COUNTERS
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_stat_account  --  add/subtract node to/from event counters
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_stat_account(const queue_node_t *node, int delta)
+{
+  unsigned flags = node->qn_counted;
+  unsigned state = flags >> ALARM_EVENT_CLIENT_BITS;
+
+  if( (flags & ALARM_EVENT_DISABLED) || state >= QUEUE_STATE_COUNT )
+  {
+    return;
+  }
+
+  queue->qc_stat_state[state] += delta;
+
+  for( unsigned bit = 0; bit < ALARM_EVENT_CLIENT_BITS; ++bit )
+  {
+    if( flags & (1u << bit) )
     {
-      queue_set_dirty();
+      queue->qc_stat_flag[state][bit] += delta;
     }
   }
-  else if( current != state )
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_stat_refresh  --  re-account node after event flags have changed
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_stat_refresh(queue_node_t *node)
+{
+  if( node->qn_counted != node->qn_event->flags )
   {
-    log_warning("[%d] TRANS: %s -> %s - BLOCKED\n",
-              self->ALARMD_PRIVATE(cookie),
-              queue_event_state_names[previous],
-              queue_event_state_names[state]);
+    queue_stat_account(node, -1);
+    node->qn_counted = node->qn_event->flags;
+    queue_stat_account(node, +1);
   }
-  else if( current == ALARM_STATE_NEW )
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_stat_flag_bit  --  map single client flag to counter index
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_stat_flag_bit(unsigned flag)
+{
+  if( flag == 0 || (flag & (flag - 1)) || (flag & ~ALARM_EVENT_CLIENT_MASK) )
   {
-    log_info("[%d] TRANS: %s -> %s\n",
-             self->ALARMD_PRIVATE(cookie),
-             queue_event_state_names[previous],
-             queue_event_state_names[current]);
+    return -1;
   }
-
-  self->flags &= ALARM_EVENT_CLIENT_MASK;
-  self->flags |= (current << ALARM_EVENT_CLIENT_BITS);
+  return __builtin_ctz(flag);
 }
 
 /* ========================================================================= *
- * QUEUE INTERFACE
+ * TOUCHED EVENTS
  * ========================================================================= */
 
 /* ------------------------------------------------------------------------- *
- * queue_add_event
+ * queue_touch_node  --  add node to the list of touched events
  * ------------------------------------------------------------------------- */
 
-cookie_t
-queue_add_event(alarm_event_t *event)
+static
+void
+queue_touch_node(queue_node_t *node, unsigned state)
 {
-  if( event->ALARMD_PRIVATE(cookie) == 0 )
+  if( !node->qn_touched )
   {
-    event->ALARMD_PRIVATE(cookie) = ++queue_cookie;
+    if( queue->qc_touched_cnt == queue->qc_touched_alloc )
+    {
+      queue->qc_touched_alloc += 32;
+      queue->qc_touched = realloc(queue->qc_touched,
+                                  queue->qc_touched_alloc * sizeof *queue->qc_touched);
+    }
+
+    queue_touch_t *touch = &queue->qc_touched[queue->qc_touched_cnt++];
+
+    touch->qt_cookie = node->qn_event->ALARMD_PRIVATE(cookie);
+    touch->qt_state  = state;
+    node->qn_touched = 1;
   }
-  else if( queue_cookie < event->ALARMD_PRIVATE(cookie) )
+}
+
+/* ========================================================================= *
+ * PENDING JOURNAL RECORDS
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_journal_mark  --  schedule journal record for event node
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_journal_mark(queue_node_t *node, unsigned type)
+{
+  node->qn_text_ok = 0;
+
+  if( node->qn_journal == 0 )
   {
-    queue_cookie = event->ALARMD_PRIVATE(cookie);
+    if( queue->qc_pending_cnt == queue->qc_pending_alloc )
+    {
+      queue->qc_pending_alloc += 32;
+      queue->qc_pending = realloc(queue->qc_pending,
+                                  queue->qc_pending_alloc * sizeof *queue->qc_pending);
+    }
+    queue->qc_pending[queue->qc_pending_cnt++] = node->qn_event->ALARMD_PRIVATE(cookie);
   }
+  node->qn_journal |= 1u << type;
+}
 
-  queue_insert_event(event);
+/* ========================================================================= *
+ * SHARED STRINGS
+ * ========================================================================= */
 
-  return event->ALARMD_PRIVATE(cookie);
+/* ------------------------------------------------------------------------- *
+ * queue_intern  --  replace private string with pooled copy
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_intern(char **pstr)
+{
+  char *str = unique_intern(*pstr);
+  free(*pstr), *pstr = str;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_get_event
+ * queue_release  --  drop pooled string
  * ------------------------------------------------------------------------- */
 
-alarm_event_t *
-queue_get_event(cookie_t cookie)
+static
+void
+queue_release(char **pstr)
+{
+  unique_release(*pstr), *pstr = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_intern_body  --  pool strings that are part of event body
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_intern_body(alarm_event_t *e)
 {
-  size_t l,h,i;
+  queue_intern(&e->sound);
+  queue_intern(&e->icon);
 
-  for( l = 0, h = queue_count; l < h; )
+  for( size_t i = 0; i < e->action_cnt; ++i )
   {
-    alarm_event_t *event = queue_by_cookie[(i = (l+h)/2)];
+    alarm_action_t *a = &e->action_tab[i];
 
-    int r = queue_cmp_cookie(event->ALARMD_PRIVATE(cookie), cookie);
+    queue_intern(&a->exec_command);
+    queue_intern(&a->dbus_interface);
+    queue_intern(&a->dbus_service);
+    queue_intern(&a->dbus_path);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_intern  --  pool strings commonly shared between events
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_intern(alarm_event_t *e)
+{
+  /* Queued events hold the application id, timezone,
+   * sound, icon and action target strings as references
+   * to the shared pool. The event functions would free()
+   * them, so they are released before the event gets
+   * deleted. Nothing modifies these fields while the
+   * event is queued; updates replace the whole event. */
+
+  queue_intern(&e->alarm_appid);
+  queue_intern(&e->alarm_tz);
+  queue_event_intern_body(e);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_release  --  undo queue_event_intern()
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_release(alarm_event_t *e)
+{
+  queue_release(&e->alarm_appid);
+  queue_release(&e->alarm_tz);
+  queue_release(&e->sound);
+  queue_release(&e->icon);
 
-    if( r < 0 ) { l = i + 1; continue; }
-    if( r > 0 ) { h = i + 0; continue; }
+  for( size_t i = 0; i < e->action_cnt; ++i )
+  {
+    alarm_action_t *a = &e->action_tab[i];
 
-    return event;
+    queue_release(&a->exec_command);
+    queue_release(&a->dbus_interface);
+    queue_release(&a->dbus_service);
+    queue_release(&a->dbus_path);
   }
-  return 0;
 }
 
+/* ========================================================================= *
+ * FLATTENED EVENT STORAGE
+ * ========================================================================= */
+
+/* Queued events keep the action, recurrence and attribute tables,
+ * the attributes and all strings that are not pooled in one block
+ * of memory owned by the queue node:
+ *
+ *   action_tab | recurrence_tab | attr_tab | attributes | strings
+ *
+ * The alarm_event_t itself stays where it is, as callers hold on
+ * to it. The block is built when the event enters the queue and
+ * rebuilt when content gets added to it (body decoded from binary
+ * snapshot, queue_event_changed()). Until then the content must
+ * not be modified with the event / action / attr functions, which
+ * would try to free() or realloc() the pieces. */
+
+/* table alignment within the block */
+#define QUEUE_BLOCK_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
 /* ------------------------------------------------------------------------- *
- * queue_del_event
+ * queue_block_has  --  pointer refers to the block of a node
  * ------------------------------------------------------------------------- */
 
+static inline
 int
-queue_del_event(cookie_t cookie)
+queue_block_has(const queue_node_t *node, const void *ptr)
 {
-  int            error = -1;
-  alarm_event_t *event = queue_get_event(cookie);
+  const char *p = ptr;
+  return (p != 0 && node->qn_block != 0 &&
+          node->qn_block <= p && p < node->qn_block + node->qn_block_size);
+}
 
-  if( event != 0 )
+/* ------------------------------------------------------------------------- *
+ * queue_block_drop  --  free piece unless it lives in the block
+ * ------------------------------------------------------------------------- */
+
+static inline
+void
+queue_block_drop(const queue_node_t *node, void *ptr)
+{
+  if( !queue_block_has(node, ptr) )
   {
-    error = 0;
-    queue_event_set_state(event, ALARM_STATE_DELETED);
+    free(ptr);
   }
-  return (error != -1);
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_query_events
+ * queue_event_is_flat  --  all of the event content lives in the block
  * ------------------------------------------------------------------------- */
 
-cookie_t *
-queue_query_events(int *pcnt, time_t lo, time_t hi, unsigned mask, unsigned flag, const char *app)
+static
+int
+queue_event_is_flat(const queue_node_t *node)
 {
-  cookie_t *res = calloc(queue_count+1, sizeof *res);
-  size_t    cnt = 0;
+  const alarm_event_t *e = node->qn_event;
 
-  if( hi <= 0 )
+  auto int flat(const void *ptr);
+
+  auto int flat(const void *ptr)
+  {
+    return ptr == 0 || queue_block_has(node, ptr);
+  }
+
+  if( !flat(e->title) || !flat(e->message) ||
+      !flat(e->action_tab) || !flat(e->recurrence_tab) || !flat(e->attr_tab) )
+  {
+    return 0;
+  }
+
+  for( size_t i = 0; i < e->action_cnt; ++i )
+  {
+    const alarm_action_t *a = &e->action_tab[i];
+
+    if( !flat(a->label) || !flat(a->dbus_name) || !flat(a->dbus_args) )
+    {
+      return 0;
+    }
+  }
+
+  for( size_t i = 0; i < e->attr_cnt; ++i )
+  {
+    const alarm_attr_t *a = e->attr_tab[i];
+
+    if( !flat(a) || !flat(a->attr_name) ||
+        (a->attr_type == ALARM_ATTR_STRING && !flat(a->attr_data.sval)) )
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_flatten  --  (re)build single allocation event storage
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_flatten(queue_node_t *node)
+{
+  alarm_event_t *e = node->qn_event;
+
+  size_t act_size = QUEUE_BLOCK_ALIGN(e->action_cnt * sizeof *e->action_tab);
+  size_t rec_size = QUEUE_BLOCK_ALIGN(e->recurrence_cnt * sizeof *e->recurrence_tab);
+  size_t tab_size = QUEUE_BLOCK_ALIGN(e->attr_cnt * sizeof *e->attr_tab);
+  size_t att_size = QUEUE_BLOCK_ALIGN(e->attr_cnt * sizeof **e->attr_tab);
+  size_t size     = act_size + rec_size + tab_size + att_size;
+
+  char  *block = 0;
+  char  *tabs  = 0;
+  char  *text  = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * pooled strings stay outside, the rest
+   * is measured & copied by field
+   * - - - - - - - - - - - - - - - - - - - */
+
+  auto void measure(const char *str);
+  auto void place(char **pstr);
+
+  auto void measure(const char *str)
+  {
+    if( str != 0 ) size += strlen(str) + 1;
+  }
+
+  auto void place(char **pstr)
+  {
+    char *str = *pstr;
+
+    if( str != 0 )
+    {
+      size_t len = strlen(str) + 1;
+
+      *pstr = memcpy(text, str, len), text += len;
+      queue_block_drop(node, str);
+    }
+  }
+
+  measure(e->title);
+  measure(e->message);
+
+  for( size_t i = 0; i < e->action_cnt; ++i )
+  {
+    measure(e->action_tab[i].label);
+    measure(e->action_tab[i].dbus_name);
+    measure(e->action_tab[i].dbus_args);
+  }
+
+  for( size_t i = 0; i < e->attr_cnt; ++i )
+  {
+    measure(e->attr_tab[i]->attr_name);
+    if( e->attr_tab[i]->attr_type == ALARM_ATTR_STRING )
+    {
+      measure(e->attr_tab[i]->attr_data.sval);
+    }
+  }
+
+  if( size == 0 )
+  {
+    goto cleanup;
+  }
+
+  tabs  = block = malloc(size);
+  text  = block + act_size + rec_size + tab_size + att_size;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * tables
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( e->action_cnt != 0 )
+  {
+    alarm_action_t *tab = (alarm_action_t *)tabs;
+
+    memcpy(tab, e->action_tab, e->action_cnt * sizeof *tab);
+    if( !queue_block_has(node, e->action_tab) )
+    {
+      pool_table_release(pool_action, e->action_cnt, e->action_tab);
+    }
+    e->action_tab = tab;
+
+    for( size_t i = 0; i < e->action_cnt; ++i )
+    {
+      place(&tab[i].label);
+      place(&tab[i].dbus_name);
+      place(&tab[i].dbus_args);
+    }
+  }
+  tabs += act_size;
+
+  if( e->recurrence_cnt != 0 )
+  {
+    alarm_recur_t *tab = (alarm_recur_t *)tabs;
+
+    memcpy(tab, e->recurrence_tab, e->recurrence_cnt * sizeof *tab);
+    if( !queue_block_has(node, e->recurrence_tab) )
+    {
+      pool_table_release(pool_recur, e->recurrence_cnt, e->recurrence_tab);
+    }
+    e->recurrence_tab = tab;
+  }
+  tabs += rec_size;
+
+  if( e->attr_cnt != 0 )
+  {
+    alarm_attr_t **tab = (alarm_attr_t **)tabs;
+    alarm_attr_t  *att = (alarm_attr_t *)(tabs + tab_size);
+
+    for( size_t i = 0; i < e->attr_cnt; ++i )
+    {
+      alarm_attr_t *old = e->attr_tab[i];
+
+      tab[i] = memcpy(&att[i], old, sizeof *old);
+      if( !queue_block_has(node, old) )
+      {
+        pool_release(&pool_attr, old);
+      }
+
+      place(&att[i].attr_name);
+      if( att[i].attr_type == ALARM_ATTR_STRING )
+      {
+        place(&att[i].attr_data.sval);
+      }
+    }
+    queue_block_drop(node, e->attr_tab);
+    e->attr_tab = tab;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * event strings
+   * - - - - - - - - - - - - - - - - - - - */
+
+  place(&e->title);
+  place(&e->message);
+
+  cleanup:
+
+  free(node->qn_block);
+  node->qn_block      = block;
+  node->qn_block_size = size;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_detach  --  forget pointers to the block of a node
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_detach(queue_node_t *node)
+{
+  alarm_event_t *e = node->qn_event;
+
+  /* everything except pooled strings lives in the block,
+   * queue_event_release() must have been called already */
+
+  if( queue_block_has(node, e->action_tab) )
+  {
+    e->action_tab = 0;
+    e->action_cnt = 0;
+  }
+  if( queue_block_has(node, e->recurrence_tab) )
+  {
+    e->recurrence_tab = 0;
+    e->recurrence_cnt = 0;
+  }
+  if( queue_block_has(node, e->attr_tab) )
+  {
+    e->attr_tab = 0;
+    e->attr_cnt = 0;
+  }
+  if( queue_block_has(node, e->title) )
+  {
+    e->title = 0;
+  }
+  if( queue_block_has(node, e->message) )
+  {
+    e->message = 0;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_node_drop_body  --  release reference to binary snapshot mapping
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_node_drop_body(queue_node_t *node)
+{
+  if( node->qn_body != 0 )
+  {
+    node->qn_body      = 0;
+    node->qn_body_size = 0;
+
+    if( --queue_bin_map_refs == 0 )
+    {
+      munmap(queue_bin_map, queue_bin_map_size);
+      queue_bin_map      = 0;
+      queue_bin_map_size = 0;
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_node_delete  --  free event and its bookkeeping node
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_node_delete(queue_node_t *node)
+{
+  queue_event_release(node->qn_event);
+  queue_event_detach(node);
+  alarm_event_delete(node->qn_event);
+  free(node->qn_text);
+  queue_node_drop_body(node);
+  free(node->qn_block);
+  free(node);
+}
+
+/* ========================================================================= *
+ * PACKED EVENT BODIES
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_bin_put_u32  --  write binary snapshot primitives
+ * ------------------------------------------------------------------------- */
+
+static inline void queue_bin_put_u32(FILE *file, uint32_t v)
+{
+  fwrite(&v, sizeof v, 1, file);
+}
+
+static inline void queue_bin_put_u64(FILE *file, uint64_t v)
+{
+  fwrite(&v, sizeof v, 1, file);
+}
+
+static inline void queue_bin_put_i64(FILE *file, int64_t v)
+{
+  fwrite(&v, sizeof v, 1, file);
+}
+
+static inline void queue_bin_put_str(FILE *file, const char *v)
+{
+  uint32_t n = v ? strlen(v) : 0;
+  queue_bin_put_u32(file, n);
+  fwrite(v ?: "", n + 1, 1, file);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_bin_get  --  read binary snapshot primitives
+ * ------------------------------------------------------------------------- */
+
+static inline void queue_bin_get(queue_rd_t *rd, void *v, size_t n)
+{
+  if( rd->qr_err || (size_t)(rd->qr_end - rd->qr_pos) < n )
+  {
+    rd->qr_err = 1;
+    memset(v, 0, n);
+  }
+  else
+  {
+    memcpy(v, rd->qr_pos, n), rd->qr_pos += n;
+  }
+}
+
+static inline uint32_t queue_bin_get_u32(queue_rd_t *rd)
+{
+  uint32_t v; queue_bin_get(rd, &v, sizeof v); return v;
+}
+
+static inline uint64_t queue_bin_get_u64(queue_rd_t *rd)
+{
+  uint64_t v; queue_bin_get(rd, &v, sizeof v); return v;
+}
+
+static inline int64_t queue_bin_get_i64(queue_rd_t *rd)
+{
+  int64_t v; queue_bin_get(rd, &v, sizeof v); return v;
+}
+
+static inline const char *queue_bin_get_str(queue_rd_t *rd)
+{
+  /* strings are stored zero terminated and
+   * can be used directly from the mapping */
+
+  uint32_t    n = queue_bin_get_u32(rd);
+  const char *v = rd->qr_pos;
+
+  if( rd->qr_err || (size_t)(rd->qr_end - rd->qr_pos) <= n || v[n] != 0 )
+  {
+    rd->qr_err = 1;
+    return "";
+  }
+  rd->qr_pos += n + 1;
+  return v;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_body_to_bin  --  write lazily decoded part of event
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_body_to_bin(FILE *file, const alarm_event_t *e)
+{
+  queue_bin_put_str(file, e->title);
+  queue_bin_put_str(file, e->message);
+  queue_bin_put_str(file, e->sound);
+  queue_bin_put_str(file, e->icon);
+
+  for( size_t i = 0; i < e->action_cnt; ++i )
+  {
+    const alarm_action_t *a = &e->action_tab[i];
+
+    queue_bin_put_str(file, a->label);
+    queue_bin_put_str(file, a->exec_command);
+    queue_bin_put_str(file, a->dbus_interface);
+    queue_bin_put_str(file, a->dbus_service);
+    queue_bin_put_str(file, a->dbus_path);
+    queue_bin_put_str(file, a->dbus_name);
+    queue_bin_put_str(file, a->dbus_args);
+  }
+
+  queue_bin_put_u32(file, e->attr_cnt);
+
+  for( size_t i = 0; i < e->attr_cnt; ++i )
+  {
+    const alarm_attr_t *a = e->attr_tab[i];
+
+    queue_bin_put_str(file, a->attr_name);
+    queue_bin_put_u32(file, a->attr_type);
+
+    switch( a->attr_type )
+    {
+    case ALARM_ATTR_NULL:
+      break;
+    case ALARM_ATTR_INT:
+      queue_bin_put_i64(file, a->attr_data.ival);
+      break;
+    case ALARM_ATTR_TIME:
+      queue_bin_put_i64(file, a->attr_data.tval);
+      break;
+    case ALARM_ATTR_STRING:
+      queue_bin_put_str(file, a->attr_data.sval);
+      break;
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_body_from_bin  --  fill in lazily decoded part of event
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_body_from_bin(alarm_event_t *e, queue_rd_t *rd)
+{
+  /* the action table itself is part of the
+   * eagerly decoded header, only the strings
+   * are filled in here */
+
+  xstrset(&e->title,   queue_bin_get_str(rd));
+  xstrset(&e->message, queue_bin_get_str(rd));
+  xstrset(&e->sound,   queue_bin_get_str(rd));
+  xstrset(&e->icon,    queue_bin_get_str(rd));
+
+  for( size_t k = 0; k < e->action_cnt; ++k )
+  {
+    alarm_action_t *a = &e->action_tab[k];
+
+    xstrset(&a->label,          queue_bin_get_str(rd));
+    xstrset(&a->exec_command,   queue_bin_get_str(rd));
+    xstrset(&a->dbus_interface, queue_bin_get_str(rd));
+    xstrset(&a->dbus_service,   queue_bin_get_str(rd));
+    xstrset(&a->dbus_path,      queue_bin_get_str(rd));
+    xstrset(&a->dbus_name,      queue_bin_get_str(rd));
+    xstrset(&a->dbus_args,      queue_bin_get_str(rd));
+  }
+
+  size_t attr_cnt = queue_bin_get_u32(rd);
+
+  if( attr_cnt > (size_t)(rd->qr_end - rd->qr_pos) )
+  {
+    rd->qr_err = 1;
+  }
+
+  for( size_t k = 0; k < attr_cnt && !rd->qr_err; ++k )
+  {
+    alarm_attr_t *a = alarm_event_add_attr(e, queue_bin_get_str(rd));
+
+    switch( queue_bin_get_u32(rd) )
+    {
+    case ALARM_ATTR_NULL:
+      alarm_attr_set_null(a);
+      break;
+    case ALARM_ATTR_INT:
+      alarm_attr_set_int(a, queue_bin_get_i64(rd));
+      break;
+    case ALARM_ATTR_TIME:
+      alarm_attr_set_time(a, queue_bin_get_i64(rd));
+      break;
+    case ALARM_ATTR_STRING:
+      alarm_attr_set_string(a, queue_bin_get_str(rd));
+      break;
+    default:
+      rd->qr_err = 1;
+      break;
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_node_unpack  --  decode event body kept from binary snapshot
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_node_unpack(queue_node_t *node)
+{
+  if( node->qn_body != 0 )
+  {
+    queue_rd_t rd;
+
+    rd.qr_pos = node->qn_body;
+    rd.qr_end = node->qn_body + node->qn_body_size;
+    rd.qr_err = 0;
+
+    queue_event_body_from_bin(node->qn_event, &rd);
+    queue_event_intern_body(node->qn_event);
+    queue_event_flatten(node);
+
+    if( rd.qr_err || rd.qr_pos != rd.qr_end )
+    {
+      log_error("[%d] packed event body corrupted\n",
+                node->qn_event->ALARMD_PRIVATE(cookie));
+    }
+
+    queue_node_drop_body(node);
+  }
+}
+
+/* ========================================================================= *
+ * QUEUE CONTEXT
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_ctx_init  --  set up empty queue context
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_ctx_init(queue_ctx_t *ctx)
+{
+  memset(ctx, 0, sizeof *ctx);
+  ctx->qc_snooze = QUEUE_SNOOZE_DEFAULT;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_ctx_select  --  make queue functions operate on given context
+ * ------------------------------------------------------------------------- */
+
+static
+queue_ctx_t *
+queue_ctx_select(queue_ctx_t *ctx)
+{
+  queue_ctx_t *prev = queue;
+  queue = ctx;
+  return prev;
+}
+
+/* ========================================================================= *
+ * INTERNAL FUNCTIONALITY
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_node  --  find bookkeeping node for event cookie
+ * ------------------------------------------------------------------------- */
+
+static
+queue_node_t *
+queue_get_node(cookie_t cookie)
+{
+  return queue_hash_lookup(cookie);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_trigger_order  --  get active events in trigger order
+ * ------------------------------------------------------------------------- */
+
+static
+alarm_event_t **
+queue_get_trigger_order(void)
+{
+  if( !queue->qc_order_ok )
+  {
+    for( size_t i = 0; i < queue->qc_count; ++i )
+    {
+      queue->qc_by_order[i] = queue->qc_by_trigger[i]->qn_event;
+    }
+
+    /* heap order is already close to sorted, but there is
+     * no cheaper way to get a fully ordered view out of it */
+    qsort(queue->qc_by_order, queue->qc_count, sizeof *queue->qc_by_order,
+          queue_cmp_event_trigger_cb);
+
+    queue->qc_order_ok = 1;
+  }
+  return queue->qc_by_order;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_lower_bound  --  first event in trigger ordered vector not before lo
+ * ------------------------------------------------------------------------- */
+
+static
+size_t
+queue_lower_bound(alarm_event_t **vec, size_t cnt, time_t lo)
+{
+  size_t i = 0, j = cnt;
+
+  while( i < j )
+  {
+    size_t k = i + (j - i) / 2;
+
+    if( vec[k]->ALARMD_PRIVATE(trigger) < lo ) i = k + 1; else j = k;
+  }
+  return i;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_cookie_order  --  get active events in cookie order
+ * ------------------------------------------------------------------------- */
+
+static
+alarm_event_t **
+queue_get_cookie_order(void)
+{
+  alarm_event_t **vec = malloc((queue->qc_count + 1) * sizeof *vec);
+
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    vec[i] = queue->qc_by_trigger[i]->qn_event;
+  }
+  vec[queue->qc_count] = 0;
+
+  qsort(vec, queue->qc_count, sizeof *vec, queue_cmp_event_cookie_cb);
+
+  return vec;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_insert_event
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_insert_event(alarm_event_t *eve)
+{
+  if( queue->qc_count == queue->qc_alloc )
+  {
+    queue->qc_alloc += 32;
+
+    queue->qc_by_trigger = realloc(queue->qc_by_trigger,
+                                   queue->qc_alloc * sizeof *queue->qc_by_trigger);
+    queue->qc_by_order   = realloc(queue->qc_by_order,
+                                   queue->qc_alloc * sizeof *queue->qc_by_order);
+  }
+
+  queue_event_intern(eve);
+
+  queue_node_t *node = calloc(1, sizeof *node);
+  node->qn_event   = eve;
+  node->qn_counted = eve->flags;
+  queue_event_flatten(node);
+  queue_stat_account(node, +1);
+
+  queue_hash_add(node);
+  queue_app_link(node);
+
+  queue->qc_by_trigger[queue->qc_count] = node;
+  queue->qc_count += 1;
+  queue_heap_sift_up(queue->qc_count - 1);
+
+  queue_state_link(node, queue_event_get_state(eve));
+  queue_touch_node(node, ALARM_STATE_NEW);
+  queue_journal_mark(node, QUEUE_JREC_ADD);
+
+  queue->qc_order_ok = 0;
+
+  queue_set_dirty();
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_remove_node  --  delete event without state transitions
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_remove_node(queue_node_t *node)
+{
+  queue_stat_account(node, -1);
+  queue_state_unlink(node, queue_event_get_state(node->qn_event));
+  queue_hash_remove(node);
+  queue_app_unlink(node);
+  queue_heap_remove(node->qn_heap);
+
+  queue_node_delete(node);
+
+  queue->qc_order_ok = 0;
+}
+
+/* ========================================================================= *
+ * INDICATION INTERFACE
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_set_modified_cb
+ * ------------------------------------------------------------------------- */
+
+void queue_set_modified_cb(void (*cb)(void))
+{
+  queue_modified_cb = cb;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_indicate_modified
+ * ------------------------------------------------------------------------- */
+
+static void queue_indicate_modified(void)
+{
+  if( queue_modified_cb != 0 )
+  {
+    queue_modified_cb();
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_set_saved_cb
+ * ------------------------------------------------------------------------- */
+
+void queue_set_saved_cb(void (*cb)(void))
+{
+  pthread_mutex_lock(&queue_writer_mutex);
+  queue_saved_cb = cb;
+  pthread_mutex_unlock(&queue_writer_mutex);
+}
+
+/* ========================================================================= *
+ * SETTINGS INTERFACE
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_snooze
+ * ------------------------------------------------------------------------- */
+
+unsigned
+queue_get_snooze(void)
+{
+  return queue->qc_snooze;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_set_snooze
+ * ------------------------------------------------------------------------- */
+
+void
+queue_set_snooze(unsigned snooze)
+{
+  if( snooze < 1 || snooze > 24*60*60 )
+  {
+    snooze = QUEUE_SNOOZE_DEFAULT;
+  }
+  if( queue->qc_snooze != snooze )
+  {
+    queue->qc_snooze = snooze;
+    queue->qc_journal_config = 1;
+  }
+  queue_set_dirty();
+}
+
+/* ========================================================================= *
+ * EVENT INTERFACE
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_set_trigger
+ * ------------------------------------------------------------------------- */
+
+void
+queue_event_set_trigger(alarm_event_t *event, time_t trigger)
+{
+  log_info("[%ld] SET TRIGGER: %s (T%s)\n",
+           (long)alarm_event_get_cookie(event),
+           ticker_date_format_long(0,0,trigger),
+           ticker_secs_format(0,0,ticker_get_time()-trigger));
+
+  queue_node_t *node = queue_get_node(event->ALARMD_PRIVATE(cookie));
+
+  event->ALARMD_PRIVATE(trigger) = trigger;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * events not yet in the queue just get
+   * the new value, for queued ones the
+   * heap order needs to be restored
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( node != 0 && node->qn_event == event )
+  {
+    queue_touch_node(node, queue_event_get_state(event));
+    queue_journal_mark(node, QUEUE_JREC_TRIGGER);
+    queue_heap_update(node->qn_heap);
+    queue->qc_order_ok = 0;
+    node->qn_app->qa_order_ok = 0;
+  }
+
+  queue_set_dirty();
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_get_state
+ * ------------------------------------------------------------------------- */
+
+unsigned
+queue_event_get_state(const alarm_event_t *self)
+{
+  return self->flags >> ALARM_EVENT_CLIENT_BITS;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_set_state
+ * ------------------------------------------------------------------------- */
+
+void
+queue_event_set_state(alarm_event_t *self, unsigned state)
+{
+  unsigned previous = queue_event_get_state(self);
+  unsigned current  = previous;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * do some filtering for state transitions
+   * occuring due to external events
+   * - - - - - - - - - - - - - - - - - - - */
+
+  switch( state )
+  {
+  default:
+    log_debug("UNKNOWN TRANSITION: %s -> %u\n",
+              queue_event_state_names[previous], state);
+    break;
+
+  case ALARM_STATE_NEW:
+  case ALARM_STATE_WAITCONN:
+  case ALARM_STATE_QUEUED:
+  case ALARM_STATE_MISSED:
+  case ALARM_STATE_POSTPONED:
+
+  case ALARM_STATE_LIMBO:
+  case ALARM_STATE_TRIGGERED:
+  case ALARM_STATE_WAITSYSUI:
+  case ALARM_STATE_SYSUI_REQ:
+
+  case ALARM_STATE_SNOOZED:
+  case ALARM_STATE_SERVED:
+  case ALARM_STATE_RECURRING:
+  case ALARM_STATE_DELETED:
+  case ALARM_STATE_FINALIZED:
+    current = state;
+    break;
+
+  case ALARM_STATE_SYSUI_ACK:
+    switch( previous )
+    {
+    case ALARM_STATE_SYSUI_REQ:
+      current = state;
+      break;
+    }
+    break;
+
+  case ALARM_STATE_SYSUI_RSP:
+    switch( previous )
+    {
+    case ALARM_STATE_SYSUI_REQ:
+    case ALARM_STATE_SYSUI_ACK:
+      current = state;
+      break;
+    }
+    break;
+  }
+
+  if( previous != current )
+  {
+    log_info("[%d] TRANS: %s -> %s\n",
+             self->ALARMD_PRIVATE(cookie),
+             queue_event_state_names[previous],
+             queue_event_state_names[current]);
+
+    if( (current == ALARM_STATE_NEW) || (current < previous) )
+    {
+      queue_set_dirty();
+    }
+  }
+  else if( current != state )
+  {
+    log_warning("[%d] TRANS: %s -> %s - BLOCKED\n",
+              self->ALARMD_PRIVATE(cookie),
+              queue_event_state_names[previous],
+              queue_event_state_names[state]);
+  }
+  else if( current == ALARM_STATE_NEW )
+  {
+    log_info("[%d] TRANS: %s -> %s\n",
+             self->ALARMD_PRIVATE(cookie),
+             queue_event_state_names[previous],
+             queue_event_state_names[current]);
+  }
+
+  self->flags &= ALARM_EVENT_CLIENT_MASK;
+  self->flags |= (current << ALARM_EVENT_CLIENT_BITS);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * move queued events to the list of
+   * the new state
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( previous != current )
+  {
+    queue_node_t *node = queue_get_node(self->ALARMD_PRIVATE(cookie));
+
+    if( node != 0 && node->qn_event == self )
+    {
+      if( current == ALARM_STATE_TRIGGERED )
+      {
+        // triggered events get presented to
+        // the user -> full content needed
+        queue_node_unpack(node);
+      }
+      queue_touch_node(node, previous);
+      queue_journal_mark(node, QUEUE_JREC_STATE);
+      queue_state_unlink(node, previous);
+      queue_state_link(node, current);
+      queue_stat_refresh(node);
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_changed  --  event content modified outside queue functions
+ * ------------------------------------------------------------------------- */
+
+void
+queue_event_changed(alarm_event_t *self)
+{
+  queue_node_t *node = queue_get_node(self->ALARMD_PRIVATE(cookie));
+
+  if( node != 0 && node->qn_event == self )
+  {
+    // typically only scalar fields change; the block
+    // is rebuilt only if content was attached to it
+    if( !queue_event_is_flat(node) )
+    {
+      queue_event_flatten(node);
+    }
+    queue_journal_mark(node, QUEUE_JREC_UPDATE);
+    queue_stat_refresh(node);
+  }
+  queue_set_dirty();
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_unpack  --  make sure all of the event content is available
+ * ------------------------------------------------------------------------- */
+
+void
+queue_event_unpack(alarm_event_t *self)
+{
+  queue_node_t *node = queue_get_node(self->ALARMD_PRIVATE(cookie));
+
+  if( node != 0 && node->qn_event == self )
+  {
+    queue_node_unpack(node);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_iter_first  --  start iterating events in given state
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t *
+queue_iter_first(queue_iter_t *iter, unsigned state)
+{
+  queue_node_t *head = queue_state_head(state);
+
+  /* Events are allowed to change state while the iteration is
+   * in progress. The events in the list at this point are marked
+   * with a fresh stamp. Visited events are moved to the tail of
+   * the list, so the unvisited ones stay at the head and any
+   * events entering the state meanwhile end up behind them. */
+
+  if( ++queue_iter_stamp == 0 )
+  {
+    ++queue_iter_stamp;
+  }
+
+  iter->qi_state = state;
+  iter->qi_stamp = queue_iter_stamp;
+
+  for( queue_node_t *node = head->qn_next; node != head; node = node->qn_next )
+  {
+    node->qn_stamp = iter->qi_stamp;
+  }
+
+  return queue_iter_next(iter);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_iter_next  --  get next event in the state being iterated
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t *
+queue_iter_next(queue_iter_t *iter)
+{
+  queue_node_t *head = queue_state_head(iter->qi_state);
+  queue_node_t *node = 0;
+
+  while( (node = head->qn_next) != head && node->qn_stamp == iter->qi_stamp )
+  {
+    queue_state_unlink(node, iter->qi_state);
+    queue_state_link(node, iter->qi_state);
+
+    if( !(node->qn_event->flags & ALARM_EVENT_DISABLED) )
+    {
+      queue_visited += 1;
+      return node->qn_event;
+    }
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_visited  --  number of events handed out for processing
+ * ------------------------------------------------------------------------- */
+
+unsigned
+queue_get_visited(void)
+{
+  return queue_visited;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_touched_count  --  number of events touched since last clear
+ * ------------------------------------------------------------------------- */
+
+size_t
+queue_touched_count(void)
+{
+  return queue->qc_touched_cnt;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_touched_get  --  get touched event and the state it was in
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t *
+queue_touched_get(size_t index, unsigned *pstate)
+{
+  alarm_event_t *eve = 0;
+
+  if( index < queue->qc_touched_cnt )
+  {
+    queue_touch_t *touch = &queue->qc_touched[index];
+
+    /* events that have already been removed
+     * from the queue are reported as null */
+
+    eve = queue_get_event(touch->qt_cookie);
+    *pstate = touch->qt_state;
+    queue_visited += 1;
+  }
+  return eve;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_touched_clear  --  forget touched events
+ * ------------------------------------------------------------------------- */
+
+void
+queue_touched_clear(void)
+{
+  for( size_t i = 0; i < queue->qc_touched_cnt; ++i )
+  {
+    queue_node_t *node = queue_get_node(queue->qc_touched[i].qt_cookie);
+
+    if( node != 0 )
+    {
+      node->qn_touched = 0;
+    }
+  }
+  queue->qc_touched_cnt = 0;
+}
+
+/* ========================================================================= *
+ * QUEUE INTERFACE
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_add_event
+ * ------------------------------------------------------------------------- */
+
+cookie_t
+queue_add_event(alarm_event_t *event)
+{
+  if( event->ALARMD_PRIVATE(cookie) == 0 )
+  {
+    event->ALARMD_PRIVATE(cookie) = ++queue->qc_cookie;
+  }
+  else if( queue->qc_cookie < event->ALARMD_PRIVATE(cookie) )
+  {
+    queue->qc_cookie = event->ALARMD_PRIVATE(cookie);
+  }
+
+  queue_insert_event(event);
+
+  return event->ALARMD_PRIVATE(cookie);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_event
+ * ------------------------------------------------------------------------- */
+
+alarm_event_t *
+queue_get_event(cookie_t cookie)
+{
+  queue_node_t *node = queue_get_node(cookie);
+
+  if( node == 0 )
+  {
+    return 0;
+  }
+
+  queue_node_unpack(node);
+  return node->qn_event;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_del_event
+ * ------------------------------------------------------------------------- */
+
+int
+queue_del_event(cookie_t cookie)
+{
+  int            error = -1;
+  alarm_event_t *event = queue_get_event(cookie);
+
+  if( event != 0 )
+  {
+    error = 0;
+    queue_event_set_state(event, ALARM_STATE_DELETED);
+  }
+  return (error != -1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_query_events
+ * ------------------------------------------------------------------------- */
+
+cookie_t *
+queue_query_events(int *pcnt, time_t lo, time_t hi, unsigned mask, unsigned flag, const char *app)
+{
+  queue_app_t *grp = 0;
+  size_t       num = queue->qc_count;
+
+  if( hi <= 0 )
   {
     hi = INT_MAX;
   }
-  if( lo <= 0 )
+  if( lo <= 0 )
+  {
+    lo = INT_MIN;
+  }
+
+  /* queries limited to one application need to look
+   * only at the events belonging to that application */
+
+  if( !xisempty(app) )
+  {
+    grp = queue_app_search(app, 0);
+    num = grp ? grp->qa_count : 0;
+  }
+
+  cookie_t *res = calloc(num+1, sizeof *res);
+  size_t    cnt = 0;
+
+  /* nothing to do if even the first event to
+   * trigger is past the end of the range */
+  alarm_event_t *first = queue_heap_peek();
+
+  if( num != 0 && first != 0 && first->ALARMD_PRIVATE(trigger) <= hi )
+  {
+    alarm_event_t **vec = (grp ? queue_app_get_trigger_order(grp) :
+                           queue_get_trigger_order());
+
+    /* skip events before the range via binary search */
+    for( size_t i = queue_lower_bound(vec, num, lo); i < num; ++i )
+    {
+      alarm_event_t *eve = vec[i];
+
+      /* Because alarms are no longer removed from queue
+       * immediately after "del_event" method call, we
+       * need to filter them out from client query results */
+
+      if( queue_event_get_state(eve) == ALARM_STATE_DELETED )
+      {
+        continue;
+      }
+
+      if( eve->ALARMD_PRIVATE(trigger) > hi ) break;
+
+      if( (eve->flags & mask) != flag )
+      {
+        continue;
+      }
+
+      res[cnt++] = eve->ALARMD_PRIVATE(cookie);
+    }
+  }
+  res[cnt] = 0;
+
+  if( pcnt ) *pcnt = cnt;
+
+  return res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_query_by_state
+ * ------------------------------------------------------------------------- */
+
+cookie_t *
+queue_query_by_state(int *pcnt, unsigned state)
+{
+  queue_node_t *head = queue_state_head(state);
+  cookie_t     *res  = calloc(queue->qc_state_count[state]+1, sizeof *res);
+  size_t        cnt  = 0;
+
+  for( queue_node_t *node = head->qn_next; node != head; node = node->qn_next )
+  {
+    alarm_event_t *eve = node->qn_event;
+
+    if( eve->flags & ALARM_EVENT_DISABLED )
+    {
+      continue;
+    }
+
+    res[cnt++] = eve->ALARMD_PRIVATE(cookie);
+  }
+  res[cnt] = 0;
+
+  if( pcnt ) *pcnt = cnt;
+
+  return res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_count_by_state
+ * ------------------------------------------------------------------------- */
+
+int
+queue_count_by_state(unsigned state)
+{
+  return (state < QUEUE_STATE_COUNT) ? queue->qc_stat_state[state] : 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_count_by_state_and_flag
+ * ------------------------------------------------------------------------- */
+
+int
+queue_count_by_state_and_flag   (unsigned state, unsigned flag)
+{
+  int bit = queue_stat_flag_bit(flag);
+
+  if( state >= QUEUE_STATE_COUNT )
+  {
+    return 0;
+  }
+
+  if( bit != -1 )
+  {
+    return queue->qc_stat_flag[state][bit];
+  }
+
+  /* flag combinations are not tracked, count the hard way */
+
+  queue_node_t *head = queue_state_head(state);
+  int           cnt  = 0;
+
+  for( queue_node_t *node = head->qn_next; node != head; node = node->qn_next )
+  {
+    alarm_event_t *eve = node->qn_event;
+
+    if( eve->flags & ALARM_EVENT_DISABLED )
+    {
+      continue;
+    }
+
+    if( eve->flags & flag )
+    {
+      cnt += 1;
+    }
+  }
+
+  return cnt;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_count_by_flag  --  number of enabled events with client flag set
+ * ------------------------------------------------------------------------- */
+
+int
+queue_count_by_flag(unsigned flag)
+{
+  int bit = queue_stat_flag_bit(flag);
+  int cnt = 0;
+
+  if( bit != -1 )
+  {
+    for( size_t i = 0; i < QUEUE_STATE_COUNT; ++i )
+    {
+      cnt += queue->qc_stat_flag[i][bit];
+    }
+  }
+  return cnt;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_state_name  --  name of event state, or null if out of range
+ * ------------------------------------------------------------------------- */
+
+const char *
+queue_get_state_name(unsigned state)
+{
+  return (state < QUEUE_STATE_COUNT) ? queue_event_state_names[state] : 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_app  --  appid and number of events of index:th application
+ * ------------------------------------------------------------------------- */
+
+const char *
+queue_get_app(size_t index, int *pcnt)
+{
+  if( index < queue->qc_app_count )
+  {
+    *pcnt = queue->qc_by_app[index]->qa_count;
+    return queue->qc_by_app[index]->qa_appid;
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_stats  --  get queue size and persistence statistics
+ * ------------------------------------------------------------------------- */
+
+void
+queue_get_stats(queue_stats_t *stats)
+{
+  stats->qs_events    = queue->qc_count;
+  stats->qs_bytes     = queue_save_stat.st_size + queue->qc_journal_size;
+  stats->qs_saved     = queue_stat_saved;
+  stats->qs_journaled = queue_stat_journaled;
+  stats->qs_skipped   = queue_stat_skipped;
+  stats->qs_failed    = queue_stat_failed;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_cleanup_deleted
+ * ------------------------------------------------------------------------- */
+
+void
+queue_cleanup_deleted(void)
+{
+  queue_node_t *head = queue_state_head(ALARM_STATE_DELETED);
+  size_t        c    = 0;
+
+  while( head->qn_next != head )
+  {
+    queue_event_set_state(head->qn_next->qn_event, ALARM_STATE_FINALIZED);
+  }
+
+  if( queue->qc_state_count[ALARM_STATE_FINALIZED] == 0 )
+  {
+    return;
+  }
+
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    queue_node_t  *node = queue->qc_by_trigger[i];
+    alarm_event_t *eve  = node->qn_event;
+
+    switch( queue_event_get_state(eve) )
+    {
+    case ALARM_STATE_FINALIZED:
+      queue_journal_mark(node, QUEUE_JREC_DELETE);
+      queue_stat_account(node, -1);
+      queue_state_unlink(node, ALARM_STATE_FINALIZED);
+      queue_hash_remove(node);
+      queue_app_unlink(node);
+      queue_node_delete(node);
+      break;
+
+    default:
+      queue->qc_by_trigger[c++] = node;
+      break;
+    }
+  }
+
+  /* removing events one by one would be O(log N) each,
+   * but when sweeping we might as well rebuild the heap
+   * in one O(N) pass */
+  queue->qc_count    = c;
+  queue->qc_order_ok = 0;
+  queue_heap_build();
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_flush_events  --  delete all events without performing actions
+ * ------------------------------------------------------------------------- */
+
+static void
+queue_flush_events(queue_ctx_t *ctx)
+{
+  queue_ctx_t *prev = queue_ctx_select(ctx);
+
+  // delete events directly, without state
+  // transitions and action execution
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    queue_node_delete(queue->qc_by_trigger[i]);
+  }
+
+  // free event tables
+  queue_state_reset();
+  queue_app_reset();
+  memset(queue->qc_stat_state, 0, sizeof queue->qc_stat_state);
+  memset(queue->qc_stat_flag,  0, sizeof queue->qc_stat_flag);
+  free(queue->qc_touched);
+  free(queue->qc_pending);
+  free(queue->qc_by_cookie);
+  free(queue->qc_by_trigger);
+  free(queue->qc_by_order);
+
+  // clear related values
+  queue->qc_by_cookie  = 0;
+  queue->qc_hash_size  = 0;
+  queue->qc_by_trigger = 0;
+  queue->qc_by_order   = 0;
+  queue->qc_order_ok   = 0;
+  queue->qc_count      = 0;
+  queue->qc_alloc      = 0;
+
+  queue->qc_touched       = 0;
+  queue->qc_touched_cnt   = 0;
+  queue->qc_touched_alloc = 0;
+
+  queue->qc_pending       = 0;
+  queue->qc_pending_cnt   = 0;
+  queue->qc_pending_alloc = 0;
+
+  queue_snap_ok       = 0;
+
+  queue_ctx_select(prev);
+}
+
+/* ========================================================================= *
+ * persistent storage functionality
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_to_writer  --  write event section as ini text
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_to_writer(iniwriter_t *out, const alarm_event_t *e)
+{
+  auto void xu(unsigned           v, const char *p, const char *k);
+  auto void xq(unsigned long long v, const char *p, const char *k);
+  auto void xi(int                v, const char *p, const char *k);
+  auto void xs(const char        *v, const char *p, const char *k);
+
+  auto void xu(unsigned v, const char *p, const char *k)
+  {
+    if( v != 0 )
+    {
+      char t[32];
+      snprintf(t, sizeof t, "%u", v);
+      iniwriter_set(out, p, k, t);
+    }
+  }
+
+  auto void xq(unsigned long long v, const char *p, const char *k)
+  {
+    if( v != 0 )
+    {
+      char t[32];
+      snprintf(t, sizeof t, "%llu", v);
+      iniwriter_set(out, p, k, t);
+    }
+  }
+  auto void xi(int v, const char *p, const char *k)
+  {
+    if( v != 0 )
+    {
+      char t[32];
+      snprintf(t, sizeof t, "%d", v);
+      iniwriter_set(out, p, k, t);
+    }
+  }
+  auto void xs(const char *v, const char *p, const char *k)
+  {
+    if( v && *v )
+    {
+      iniwriter_set(out, p, k, v);
+    }
+  }
+
+  char sec[32];
+  char pfx[32];
+
+  snprintf(sec, sizeof sec, "#%08x", (unsigned)e->ALARMD_PRIVATE(cookie));
+  iniwriter_begin(out, sec);
+
+#define Xu2(n,v) xu(e->v, 0, #n)
+#define Xi2(n,v) xi(e->v, 0, #n)
+#define Xs2(n,v) xs(e->v, 0, #n)
+
+#define Xu(v) Xu2(v,v)
+#define Xi(v) Xi2(v,v)
+#define Xs(v) Xs2(v,v)
+
+  Xu2(cookie,  ALARMD_PRIVATE(cookie));
+  Xi2(trigger, ALARMD_PRIVATE(trigger));
+
+  Xs(title);
+  Xs(message);
+  Xs(sound);
+  Xs(icon);
+  Xu(flags);
+
+  Xs(alarm_appid);
+
+  Xi(alarm_time);
+
+  Xi(alarm_tm.tm_year);
+  Xi(alarm_tm.tm_mon);
+  Xi(alarm_tm.tm_mday);
+  Xi(alarm_tm.tm_hour);
+  Xi(alarm_tm.tm_min);
+  Xi(alarm_tm.tm_sec);
+  Xi(alarm_tm.tm_wday);
+  Xi(alarm_tm.tm_yday);
+  Xi(alarm_tm.tm_isdst);
+
+  Xs(alarm_tz);
+
+  Xi(recur_secs);
+  Xi(recur_count);
+
+  Xi(snooze_secs);
+  Xi(snooze_total);
+
+  Xu(action_cnt);
+  Xu(recurrence_cnt);
+  Xu(attr_cnt);
+
+#undef Xu
+#undef Xi
+#undef Xs
+
+#undef Xu2
+#undef Xi2
+#undef Xs2
+
+  for( size_t i = 0; i < e->action_cnt; ++i )
+  {
+    alarm_action_t  *a= &e->action_tab[i];
+
+    snprintf(pfx, sizeof pfx, "action%d.", (int)i);
+
+#define Xu(v) xu(a->v, pfx, #v)
+#define Xs(v) xs(a->v, pfx, #v)
+
+    Xu(flags);
+    Xs(label);
+    Xs(exec_command);
+    Xs(dbus_interface);
+    Xs(dbus_service);
+    Xs(dbus_path);
+    Xs(dbus_name);
+    Xs(dbus_args);
+
+#undef Xu
+#undef Xs
+  }
+
+  for( size_t i = 0; i < e->recurrence_cnt; ++i )
+  {
+    alarm_recur_t  *r= &e->recurrence_tab[i];
+
+    snprintf(pfx, sizeof pfx, "recurrence_tab%d.", (int)i);
+
+#define Xu(v) xu(r->v, pfx, #v)
+#define Xq(v) xq(r->v, pfx, #v)
+
+    Xq(mask_min);
+    Xu(mask_hour);
+    Xu(mask_mday);
+    Xu(mask_wday);
+    Xu(mask_mon);
+    Xu(special);
+
+#undef Xu
+#undef Xq
+  }
+
+  for( size_t i = 0; i < e->attr_cnt; ++i )
+  {
+    alarm_attr_t  *a= e->attr_tab[i];
+
+    snprintf(pfx, sizeof pfx, "attr%d.", (int)i);
+
+#define Xi(v) xi(a->v, pfx, #v)
+#define Xs(v) xs(a->v, pfx, #v)
+
+    Xs(attr_name);
+    Xi(attr_type);
+    switch( a->attr_type )
+    {
+    case ALARM_ATTR_NULL:
+      break;
+    case ALARM_ATTR_INT:
+      Xi(attr_data.ival);
+      break;
+    case ALARM_ATTR_TIME:
+      Xi(attr_data.tval);
+      break;
+    case ALARM_ATTR_STRING:
+      Xs(attr_data.sval);
+      break;
+    }
+#undef Xi
+#undef Xs
+  }
+
+  iniwriter_end(out);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_log_ini_memory  --  report memory used for ini file tree
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_log_ini_memory(const char *what, const inifile_t *ini)
+{
+  size_t blocks = 0, used = 0, size = 0;
+
+  inifile_get_memory_usage(ini, &blocks, &used, &size);
+
+  log_debug("%s: ini tree %lu bytes, %lu blocks of %lu bytes\n", what,
+            (unsigned long)used, (unsigned long)blocks, (unsigned long)size);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_text_hash  --  64 bit FNV-1a hash over data
+ * ------------------------------------------------------------------------- */
+
+static
+uint64_t
+queue_text_hash(uint64_t hash, const void *data, size_t size)
+{
+  const unsigned char *pos = data;
+
+  for( size_t i = 0; i < size; ++i )
+  {
+    hash ^= pos[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_node_get_text  --  ini text for event, rewritten only if changed
+ * ------------------------------------------------------------------------- */
+
+static
+const char *
+queue_node_get_text(queue_node_t *node, size_t *psize)
+{
+  if( !node->qn_text_ok )
+  {
+    iniwriter_t out;
+
+    queue_node_unpack(node);
+    iniwriter_ctor(&out);
+    queue_event_to_writer(&out, node->qn_event);
+
+    free(node->qn_text);
+    node->qn_text      = iniwriter_steal(&out, &node->qn_text_size);
+    node->qn_text_hash = queue_text_hash(0xcbf29ce484222325ull,
+                                         node->qn_text, node->qn_text_size);
+    node->qn_text_ok   = 1;
+
+    iniwriter_dtor(&out);
+  }
+
+  *psize = node->qn_text_size;
+  return node->qn_text;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_save_to_memory
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_save_to_memory(char **pdata, size_t *psize, unsigned gen,
+                     uint64_t *phash)
+{
+  iniwriter_t     out;
+  alarm_event_t **vec  = queue_get_cookie_order();
+  uint64_t        hash = 0xcbf29ce484222325ull;
+  char            tmp[32];
+
+  /* the cached text of unchanged events is used as is; the content
+   * hash covers everything except the snapshot generation */
+
+  iniwriter_ctor(&out);
+
+  iniwriter_begin(&out, "config");
+  snprintf(tmp, sizeof tmp, "%u", queue->qc_snooze);
+  iniwriter_set(&out, 0, "snooze", tmp);
+  hash = queue_text_hash(hash, tmp, strlen(tmp) + 1);
+  snprintf(tmp, sizeof tmp, "%u", gen);
+  iniwriter_set(&out, 0, "journal", tmp);
+  iniwriter_end(&out);
+
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    queue_node_t *node = queue_get_node(vec[i]->ALARMD_PRIVATE(cookie));
+    size_t        size = 0;
+    const char   *text = queue_node_get_text(node, &size);
+
+    iniwriter_append(&out, text, size);
+    hash = queue_text_hash(hash, &node->qn_text_hash,
+                           sizeof node->qn_text_hash);
+  }
+
+  *pdata = iniwriter_steal(&out, psize);
+  *phash = hash;
+  iniwriter_dtor(&out);
+  free(vec);
+
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_from_ini  --  create event from ini file section
+ * ------------------------------------------------------------------------- */
+
+static
+alarm_event_t *
+queue_event_from_ini(inifile_t *ini, const char *sec)
+{
+  alarm_event_t *e = alarm_event_create();
+
+  size_t cnt;
+
+  if( inifile_getfmt(ini, sec, "action_cnt", "%zi", &cnt) == 1 )
+  {
+    alarm_event_add_actions(e, cnt);
+  }
+  if( inifile_getfmt(ini, sec, "recurrence_cnt", "%zi", &cnt) == 1 )
+  {
+    alarm_event_add_recurrences(e, cnt);
+  }
+
+#define Xu2(n,v) e->v = strtoul(inifile_get(ini, sec, #n, ""),0,0)
+#define Xi2(n,v) e->v = strtol(inifile_get(ini, sec, #n, ""),0,0)
+#define Xs2(n,v) xstrset(&(e->v), inifile_get(ini, sec, #n, ""))
+
+#define Xu(v) Xu2(v,v)
+#define Xi(v) Xi2(v,v)
+#define Xs(v) Xs2(v,v)
+
+  Xu2(cookie,  ALARMD_PRIVATE(cookie));
+  Xi2(trigger, ALARMD_PRIVATE(trigger));
+
+  Xs(title);
+  Xs(message);
+  Xs(sound);
+  Xs(icon);
+  Xu(flags);
+
+  Xs(alarm_appid);
+
+  Xi(alarm_time);
+
+  Xi(alarm_tm.tm_year);
+  Xi(alarm_tm.tm_mon);
+  Xi(alarm_tm.tm_mday);
+  Xi(alarm_tm.tm_hour);
+  Xi(alarm_tm.tm_min);
+  Xi(alarm_tm.tm_sec);
+  Xi(alarm_tm.tm_wday);
+  Xi(alarm_tm.tm_yday);
+  Xi(alarm_tm.tm_isdst);
+
+  Xs(alarm_tz);
+
+  Xi(recur_secs);
+  Xi(recur_count);
+
+  Xi(snooze_secs);
+  Xi(snooze_total);
+
+#undef Xu
+#undef Xi
+#undef Xs
+
+#undef Xu2
+#undef Xi2
+#undef Xs2
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * action table
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t k = 0; k < e->action_cnt; ++k )
+  {
+    alarm_action_t  *a = &e->action_tab[k];
+    char key[64];
+
+#define Xu(v) \
+  snprintf(key, sizeof key, "action%d.%s", (int)k, #v);\
+  a->v = strtoul(inifile_get(ini, sec, key, ""),0,0)
+
+#define Xs(v)\
+  snprintf(key, sizeof key, "action%d.%s", (int)k, #v);\
+  xstrset(&a->v, inifile_get(ini, sec, key, ""))
+
+    Xu(flags);
+    Xs(label);
+    Xs(exec_command);
+    Xs(dbus_interface);
+    Xs(dbus_service);
+    Xs(dbus_path);
+    Xs(dbus_name);
+    Xs(dbus_args);
+
+#undef Xu
+#undef Xs
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * recurrence table
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t k = 0; k < e->recurrence_cnt; ++k )
+  {
+    alarm_recur_t  *r = &e->recurrence_tab[k];
+    char key[64];
+
+#define Xu(v) \
+  snprintf(key, sizeof key, "recurrence_tab%d.%s", (int)k, #v);\
+  r->v = strtoul(inifile_get(ini, sec, key,  ""),0,0)
+
+#define Xq(v)\
+  snprintf(key, sizeof key, "recurrence_tab%d.%s", (int)k, #v);\
+  r->v = strtoull(inifile_get(ini, sec, key,  ""),0,0)
+
+    Xq(mask_min);
+    Xu(mask_hour);
+    Xu(mask_mday);
+    Xu(mask_wday);
+    Xu(mask_mon);
+    Xu(special);
+
+#undef Xu
+#undef Xq
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * attribute table
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( inifile_getfmt(ini, sec, "attr_cnt", "%zi", &cnt) != 1 )
+  {
+    cnt = 0;
+  }
+
+  for( size_t k = 0; k < cnt; ++k )
+  {
+    alarm_attr_t  *a = 0;
+    char key[64];
+
+#define X(v) \
+  (snprintf(key, sizeof key, "attr%d.%s", (int)k, #v),\
+   inifile_get(ini, sec, key, ""))
+
+    a = alarm_event_add_attr(e, X(attr_name));
+
+    switch( strtol(X(attr_type),0,0) )
+    {
+    default:
+    case ALARM_ATTR_NULL:
+      alarm_attr_set_null(a);
+      break;
+    case ALARM_ATTR_INT:
+      alarm_attr_set_int(a, strtol(X(attr_data.ival),0,0));
+      break;
+    case ALARM_ATTR_TIME:
+      alarm_attr_set_time(a, strtol(X(attr_data.tval),0,0));
+      break;
+    case ALARM_ATTR_STRING:
+      alarm_attr_set_string(a, X(attr_data.sval));
+      break;
+    }
+#undef X
+  }
+
+  return e;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_load_from_ini  --  add events from ini file to queue
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_load_from_ini(inifile_t *ini)
+{
+  char **secs = 0;
+
+  if( (secs = inifile_get_section_names(ini, 0)) != 0 )
+  {
+    for( size_t i = 0; secs[i]; ++i )
+    {
+      const char *sec = secs[i];
+
+      if( *sec != '#' ) continue;
+
+      alarm_event_t *e = queue_event_from_ini(ini, sec);
+
+      /* - - - - - - - - - - - - - - - - - - - *
+       * replace if already in queue
+       * - - - - - - - - - - - - - - - - - - - */
+
+      queue_node_t *node = queue_get_node(e->ALARMD_PRIVATE(cookie));
+
+      if( node != 0 )
+      {
+        queue_remove_node(node);
+      }
+
+      /* - - - - - - - - - - - - - - - - - - - *
+       * add to queue
+       * - - - - - - - - - - - - - - - - - - - */
+
+#if 0 // disabled: rejecting events on load might cause regression
+      if( alarm_event_is_sane(e) != -1 )
+      {
+        queue_add_event(e), e = 0;
+      }
+      alarm_event_delete(e);
+#else
+      //alarm_event_is_sane(e);
+      queue_add_event(e);
+#endif
+    }
+  }
+
+  xfreev(secs);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_load_from_path
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_load_from_path(queue_ctx_t *ctx, const char *path, unsigned *pgen)
+{
+  int          err    = -1;
+  queue_ctx_t *prev   = queue_ctx_select(ctx);
+  inifile_t   *ini    = inifile_create();
+  unsigned     snooze = 0;
+  unsigned     gen    = 0;
+
+  if( inifile_load(ini, path) == -1 )
+  {
+    log_warning("%s: load failed\n", path);
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * parse data from save file
+   * - - - - - - - - - - - - - - - - - - - */
+
+  inifile_getfmt(ini, "config", "snooze", "%u", &snooze);
+  inifile_getfmt(ini, "config", "journal", "%u", &gen);
+  queue_set_snooze(snooze);
+
+  queue_load_from_ini(ini);
+
+  queue_log_ini_memory(path, ini);
+
+  err = 0;
+
+  cleanup:
+
+  inifile_delete(ini);
+
+  queue_ctx_select(prev);
+
+  *pgen = gen;
+  return err;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_load_normalize_event  --  set initial state for loaded event
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_load_normalize_event(alarm_event_t *e)
+{
+  switch( queue_event_get_state(e) )
+  {
+  case ALARM_STATE_LIMBO:
+  case ALARM_STATE_TRIGGERED:
+  case ALARM_STATE_WAITSYSUI:
+  case ALARM_STATE_SYSUI_REQ:
+  case ALARM_STATE_SYSUI_ACK:
+  case ALARM_STATE_SYSUI_RSP:
+    // put alarms that were in triggered state
+    // back to limbo so that we have a chance
+    // to evaluate conditions and perform actions
+    // again
+    queue_event_set_state(e, ALARM_STATE_LIMBO);
+    break;
+
+  default:
+    queue_event_set_state(e, ALARM_STATE_NEW);
+    break;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_load_normalize  --  set initial state for loaded events
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_load_normalize(void)
+{
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    queue_load_normalize_event(queue->qc_by_trigger[i]->qn_event);
+  }
+}
+
+/* ========================================================================= *
+ * binary snapshot functionality
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_to_bin  --  write event to binary snapshot stream
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_event_to_bin(FILE *file, const queue_node_t *node)
+{
+  const alarm_event_t *e = node->qn_event;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * header: everything scheduling needs
+   * - - - - - - - - - - - - - - - - - - - */
+
+  queue_bin_put_u32(file, e->ALARMD_PRIVATE(cookie));
+  queue_bin_put_i64(file, e->ALARMD_PRIVATE(trigger));
+
+  queue_bin_put_u32(file, e->flags);
+
+  queue_bin_put_str(file, e->alarm_appid);
+
+  queue_bin_put_i64(file, e->alarm_time);
+
+  queue_bin_put_i64(file, e->alarm_tm.tm_year);
+  queue_bin_put_i64(file, e->alarm_tm.tm_mon);
+  queue_bin_put_i64(file, e->alarm_tm.tm_mday);
+  queue_bin_put_i64(file, e->alarm_tm.tm_hour);
+  queue_bin_put_i64(file, e->alarm_tm.tm_min);
+  queue_bin_put_i64(file, e->alarm_tm.tm_sec);
+  queue_bin_put_i64(file, e->alarm_tm.tm_wday);
+  queue_bin_put_i64(file, e->alarm_tm.tm_yday);
+  queue_bin_put_i64(file, e->alarm_tm.tm_isdst);
+
+  queue_bin_put_str(file, e->alarm_tz);
+
+  queue_bin_put_i64(file, e->recur_secs);
+  queue_bin_put_i64(file, e->recur_count);
+
+  queue_bin_put_i64(file, e->snooze_secs);
+  queue_bin_put_i64(file, e->snooze_total);
+
+  queue_bin_put_u32(file, e->action_cnt);
+  queue_bin_put_u32(file, e->recurrence_cnt);
+
+  for( size_t i = 0; i < e->action_cnt; ++i )
+  {
+    queue_bin_put_u32(file, e->action_tab[i].flags);
+  }
+
+  for( size_t i = 0; i < e->recurrence_cnt; ++i )
+  {
+    const alarm_recur_t *r = &e->recurrence_tab[i];
+
+    queue_bin_put_u64(file, r->mask_min);
+    queue_bin_put_u32(file, r->mask_hour);
+    queue_bin_put_u32(file, r->mask_mday);
+    queue_bin_put_u32(file, r->mask_wday);
+    queue_bin_put_u32(file, r->mask_mon);
+    queue_bin_put_u32(file, r->special);
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * body: size prefixed so that it can be
+   * skipped on load; bodies that have not
+   * been decoded are copied as is
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( node->qn_body != 0 )
+  {
+    queue_bin_put_u32(file, node->qn_body_size);
+    fwrite(node->qn_body, node->qn_body_size, 1, file);
+  }
+  else
+  {
+    off_t pos = ftello(file);
+    off_t end = 0;
+
+    queue_bin_put_u32(file, 0);
+    queue_event_body_to_bin(file, e);
+
+    end = ftello(file);
+    fseeko(file, pos, SEEK_SET);
+    queue_bin_put_u32(file, end - pos - sizeof(uint32_t));
+    fseeko(file, end, SEEK_SET);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_event_from_bin  --  create event from binary snapshot data
+ * ------------------------------------------------------------------------- */
+
+static
+alarm_event_t *
+queue_event_from_bin(queue_rd_t *rd, const char **pbody, size_t *psize)
+{
+  alarm_event_t *e = alarm_event_create();
+
+  e->ALARMD_PRIVATE(cookie)  = queue_bin_get_u32(rd);
+  e->ALARMD_PRIVATE(trigger) = queue_bin_get_i64(rd);
+
+  e->flags = queue_bin_get_u32(rd);
+
+  xstrset(&e->alarm_appid, queue_bin_get_str(rd));
+
+  e->alarm_time = queue_bin_get_i64(rd);
+
+  e->alarm_tm.tm_year  = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_mon   = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_mday  = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_hour  = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_min   = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_sec   = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_wday  = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_yday  = queue_bin_get_i64(rd);
+  e->alarm_tm.tm_isdst = queue_bin_get_i64(rd);
+
+  xstrset(&e->alarm_tz, queue_bin_get_str(rd));
+
+  e->recur_secs   = queue_bin_get_i64(rd);
+  e->recur_count  = queue_bin_get_i64(rd);
+
+  e->snooze_secs  = queue_bin_get_i64(rd);
+  e->snooze_total = queue_bin_get_i64(rd);
+
+  size_t action_cnt     = queue_bin_get_u32(rd);
+  size_t recurrence_cnt = queue_bin_get_u32(rd);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * every table entry takes at least some
+   * bytes of data -> reject bogus counts
+   * before allocating anything
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( action_cnt + recurrence_cnt > (size_t)(rd->qr_end - rd->qr_pos) )
+  {
+    rd->qr_err = 1;
+    goto cleanup;
+  }
+
+  if( action_cnt != 0 )
+  {
+    alarm_event_add_actions(e, action_cnt);
+  }
+  if( recurrence_cnt != 0 )
+  {
+    alarm_event_add_recurrences(e, recurrence_cnt);
+  }
+
+  for( size_t k = 0; k < e->action_cnt; ++k )
+  {
+    e->action_tab[k].flags = queue_bin_get_u32(rd);
+  }
+
+  for( size_t k = 0; k < e->recurrence_cnt; ++k )
+  {
+    alarm_recur_t *r = &e->recurrence_tab[k];
+
+    r->mask_min  = queue_bin_get_u64(rd);
+    r->mask_hour = queue_bin_get_u32(rd);
+    r->mask_mday = queue_bin_get_u32(rd);
+    r->mask_wday = queue_bin_get_u32(rd);
+    r->mask_mon  = queue_bin_get_u32(rd);
+    r->special   = queue_bin_get_u32(rd);
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the body is just located here, it gets
+   * decoded on first use
+   * - - - - - - - - - - - - - - - - - - - */
+
+  size_t size = queue_bin_get_u32(rd);
+
+  if( rd->qr_err || size > (size_t)(rd->qr_end - rd->qr_pos) )
+  {
+    rd->qr_err = 1;
+    goto cleanup;
+  }
+
+  *pbody = rd->qr_pos, rd->qr_pos += size;
+  *psize = size;
+
+  cleanup:
+
+  return e;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_bin_encode  --  binary snapshot image, ini stats filled in later
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_bin_encode(unsigned gen, char **pdata, size_t *psize)
+{
+  int             err  = -1;
+  FILE           *file = 0;
+  char           *data = 0;
+  size_t          size = 0;
+  alarm_event_t **vec  = queue_get_cookie_order();
+  queue_bin_t     head;
+
+  if( (file = open_memstream(&data, &size)) == 0 )
+  {
+    log_warning("%s: open: %s\n", "<ram>", strerror(errno));
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * reserve space for header, fill it in
+   * when the event data is ready
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memset(&head, 0, sizeof head);
+  fwrite(&head, sizeof head, 1, file);
+
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    queue_event_to_bin(file, queue_get_node(vec[i]->ALARMD_PRIVATE(cookie)));
+  }
+
+  if( ferror(file) != 0 || fclose(file) == EOF )
+  {
+    file = 0;
+    goto cleanup;
+  }
+  file = 0;
+
+  memcpy(head.qb_magic, QUEUE_BINARY_MAGIC, sizeof head.qb_magic);
+  head.qb_version   = QUEUE_BINARY_VERSION;
+  head.qb_size      = size - sizeof head;
+  head.qb_crc       = xcrc32(0, data + sizeof head, head.qb_size);
+  head.qb_count     = queue->qc_count;
+  head.qb_gen       = gen;
+  head.qb_snooze    = queue->qc_snooze;
+  memcpy(data, &head, sizeof head);
+
+  *pdata = data, data = 0;
+  *psize = size;
+
+  err = 0;
+
+  cleanup:
+
+  if( file != 0 ) fclose(file);
+  free(data);
+  free(vec);
+
+  return err;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_bin_write  --  tie binary image to current ini file and write it
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_bin_write(char *data, size_t size)
+{
+  queue_bin_t head;
+  struct stat ini;
+
+  xfetchstats(QUEUE_DATABASE, &ini);
+
+  memcpy(&head, data, sizeof head);
+  head.qb_ini_size  = ini.st_size;
+  head.qb_ini_mtime = ini.st_mtime;
+  memcpy(data, &head, sizeof head);
+
+  if( xsavefile(QUEUE_BINTEMP, 0666, data, size) == -1 )
+  {
+    return -1;
+  }
+
+  if( rename(QUEUE_BINTEMP, QUEUE_BINARY) == -1 )
+  {
+    log_error("rename %s -> %s: %s\n", QUEUE_BINTEMP, QUEUE_BINARY,
+              strerror(errno));
+    return -1;
+  }
+
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_bin_save  --  write binary snapshot matching the ini file
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_bin_save(unsigned gen)
+{
+  int     err  = -1;
+  char   *data = 0;
+  size_t  size = 0;
+
+  if( queue_bin_encode(gen, &data, &size) != -1 )
+  {
+    err = queue_bin_write(data, size);
+  }
+
+  free(data);
+
+  return err;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_bin_load  --  load events from binary snapshot
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_bin_load(unsigned *pgen)
+{
+  int             err  = -1;
+  int             file = -1;
+  void           *base = MAP_FAILED;
+  size_t          size = 0;
+  alarm_event_t **vec  = 0;
+  const char    **body = 0;
+  size_t         *blen = 0;
+  size_t          cnt  = 0;
+  queue_bin_t     head;
+  queue_rd_t      rd;
+  struct stat     st, ini;
+
+  if( (file = open(QUEUE_BINARY, O_RDONLY)) == -1 )
+  {
+    goto cleanup;
+  }
+
+  if( fstat(file, &st) == -1 || (size = st.st_size) < sizeof head )
+  {
+    goto cleanup;
+  }
+
+  if( (base = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0)) == MAP_FAILED )
+  {
+    log_warning("%s: mmap: %s\n", QUEUE_BINARY, strerror(errno));
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * validate header & checksum
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memcpy(&head, base, sizeof head);
+  xfetchstats(QUEUE_DATABASE, &ini);
+
+  if( memcmp(head.qb_magic, QUEUE_BINARY_MAGIC, sizeof head.qb_magic) ||
+      head.qb_version != QUEUE_BINARY_VERSION ||
+      head.qb_size    != size - sizeof head )
+  {
+    log_warning("%s: unknown format - ignored\n", QUEUE_BINARY);
+    goto cleanup;
+  }
+
+  if( head.qb_ini_size  != ini.st_size ||
+      head.qb_ini_mtime != ini.st_mtime )
+  {
+    log_notice("%s: out of date - ignored\n", QUEUE_BINARY);
+    goto cleanup;
+  }
+
+  if( head.qb_crc != xcrc32(0, (char *)base + sizeof head, head.qb_size) )
+  {
+    log_warning("%s: checksum mismatch - ignored\n", QUEUE_BINARY);
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * decode all events before adding any
+   * of them to the queue
+   * - - - - - - - - - - - - - - - - - - - */
+
+  rd.qr_pos = (char *)base + sizeof head;
+  rd.qr_end = (char *)base + size;
+  rd.qr_err = 0;
+
+  if( head.qb_count > head.qb_size )
+  {
+    goto cleanup;
+  }
+
+  vec  = calloc(head.qb_count, sizeof *vec);
+  body = calloc(head.qb_count, sizeof *body);
+  blen = calloc(head.qb_count, sizeof *blen);
+
+  while( cnt < head.qb_count && !rd.qr_err )
+  {
+    vec[cnt] = queue_event_from_bin(&rd, &body[cnt], &blen[cnt]);
+    ++cnt;
+  }
+
+  if( rd.qr_err || rd.qr_pos != rd.qr_end )
+  {
+    log_warning("%s: corrupted data - ignored\n", QUEUE_BINARY);
+    goto cleanup;
+  }
+
+  queue_set_snooze(head.qb_snooze);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * event bodies are left in the mapping
+   * until decoded, see queue_node_unpack();
+   * duplicate cookies replace earlier
+   * events as in queue_load_from_ini()
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < cnt; ++i )
+  {
+    queue_node_t *node = queue_get_node(vec[i]->ALARMD_PRIVATE(cookie));
+
+    if( node != 0 )
+    {
+      queue_remove_node(node);
+    }
+
+    node = queue_get_node(queue_add_event(vec[i]));
+
+    if( node != 0 && node->qn_event == vec[i] )
+    {
+      node->qn_body      = body[i];
+      node->qn_body_size = blen[i];
+      queue_bin_map_refs += 1;
+    }
+    vec[i] = 0;
+  }
+
+  if( queue_bin_map_refs != 0 )
+  {
+    queue_bin_map      = base;
+    queue_bin_map_size = size;
+    base = MAP_FAILED;
+  }
+
+  *pgen = head.qb_gen;
+  err = 0;
+
+  cleanup:
+
+  if( vec != 0 )
+  {
+    for( size_t i = 0; i < cnt; ++i )
+    {
+      alarm_event_delete(vec[i]);
+    }
+    free(vec);
+  }
+  free(body);
+  free(blen);
+
+  if( base != MAP_FAILED ) munmap(base, size);
+  if( file != -1 ) close(file);
+
+  return err;
+}
+
+/* ========================================================================= *
+ * background writer functionality
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_write_create
+ * ------------------------------------------------------------------------- */
+
+static
+queue_write_t *
+queue_write_create(void)
+{
+  queue_write_t *self = calloc(1, sizeof *self);
+  self->qw_result = -1;
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_write_delete
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_write_delete(queue_write_t *self)
+{
+  if( self != 0 )
+  {
+    free(self->qw_ini);
+    free(self->qw_bin);
+    free(self->qw_jnl);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_write_merge  --  combine later write with a waiting one
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_write_merge(queue_write_t *self, queue_write_t *later)
+{
+  if( later->qw_ini != 0 || later->qw_reset )
+  {
+    /* new snapshot or journal start makes the
+     * waiting content unnecessary */
+
+    free(self->qw_ini);
+    free(self->qw_bin);
+    free(self->qw_jnl);
+
+    self->qw_ini      = later->qw_ini,  later->qw_ini = 0;
+    self->qw_ini_size = later->qw_ini_size;
+    self->qw_bin      = later->qw_bin,  later->qw_bin = 0;
+    self->qw_bin_size = later->qw_bin_size;
+    self->qw_jnl      = later->qw_jnl,  later->qw_jnl = 0;
+    self->qw_jnl_size = later->qw_jnl_size;
+    self->qw_reset    = later->qw_reset;
+    self->qw_hash     = later->qw_hash;
+  }
+  else
+  {
+    /* journal records are appended after
+     * whatever the waiting write has */
+
+    size_t size = self->qw_jnl_size + later->qw_jnl_size;
+
+    self->qw_jnl = realloc(self->qw_jnl, size);
+    memcpy(self->qw_jnl + self->qw_jnl_size, later->qw_jnl,
+           later->qw_jnl_size);
+    self->qw_jnl_size = size;
+  }
+
+  queue_write_delete(later);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_write_execute  --  do the file operations
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_write_execute(queue_write_t *self)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * after a failed write the journal file
+   * is missing records -> appending to it
+   * is pointless until it is restarted
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( queue_writer_broken && !self->qw_reset )
+  {
+    goto cleanup;
+  }
+
+  if( self->qw_ini != 0 )
+  {
+    if( xsavefile(QUEUE_TEMPSAVE, 0666, self->qw_ini, self->qw_ini_size) == -1 ||
+        xcyclefiles(QUEUE_TEMPSAVE, QUEUE_DATABASE, QUEUE_BACKUP) == -1 )
+    {
+      goto cleanup;
+    }
+
+    xfetchstats(QUEUE_DATABASE, &self->qw_stat);
+    self->qw_ini_ok = 1;
+
+    if( self->qw_bin != 0 )
+    {
+      queue_bin_write(self->qw_bin, self->qw_bin_size);
+    }
+  }
+
+  if( self->qw_jnl != 0 )
+  {
+    if( self->qw_reset )
+    {
+      if( xsavefile(QUEUE_JOURNAL, 0666, self->qw_jnl, self->qw_jnl_size) == -1 )
+      {
+        goto cleanup;
+      }
+    }
+    else if( xappendfile(QUEUE_JOURNAL, 0666, self->qw_jnl, self->qw_jnl_size) == -1 )
+    {
+      goto cleanup;
+    }
+  }
+
+  self->qw_result = self->qw_ini ? 1 : self->qw_reset ? 0 : 2;
+
+  cleanup:
+
+  queue_writer_broken = (self->qw_result == -1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_writer_finish  --  add write to the list of finished ones
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_writer_finish(queue_write_t *self)
+{
+  queue_write_t **tail = &queue_writer_done;
+
+  while( *tail != 0 )
+  {
+    tail = &(*tail)->qw_next;
+  }
+  *tail = self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_writer_thread  --  execute writes handed over by the mainloop
+ * ------------------------------------------------------------------------- */
+
+static
+void *
+queue_writer_thread(void *aptr)
+{
+  pthread_mutex_lock(&queue_writer_mutex);
+
+  for( ;; )
+  {
+    while( queue_writer_next == 0 && !queue_writer_quit )
+    {
+      pthread_cond_wait(&queue_writer_cond, &queue_writer_mutex);
+    }
+
+    if( (queue_writer_busy = queue_writer_next) == 0 )
+    {
+      break;
+    }
+    queue_writer_next = 0;
+
+    pthread_mutex_unlock(&queue_writer_mutex);
+    queue_write_execute(queue_writer_busy);
+    pthread_mutex_lock(&queue_writer_mutex);
+
+    queue_writer_finish(queue_writer_busy);
+    queue_writer_busy = 0;
+    pthread_cond_broadcast(&queue_writer_cond);
+
+    if( queue_saved_cb != 0 )
+    {
+      queue_saved_cb();
+    }
+  }
+
+  pthread_mutex_unlock(&queue_writer_mutex);
+
+  return aptr;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_writer_submit  --  hand write over to writer thread
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_writer_submit(queue_write_t *self)
+{
+  if( !queue_writer_running )
+  {
+    queue_write_execute(self);
+    queue_writer_finish(self);
+    queue_writer_jobs += 1;
+    return;
+  }
+
+  pthread_mutex_lock(&queue_writer_mutex);
+
+  if( queue_writer_next != 0 )
+  {
+    queue_write_merge(queue_writer_next, self);
+  }
+  else
+  {
+    queue_writer_next  = self;
+    queue_writer_jobs += 1;
+  }
+
+  pthread_cond_broadcast(&queue_writer_cond);
+  pthread_mutex_unlock(&queue_writer_mutex);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_writer_wait  --  wait until all writes have been finished
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_writer_wait(void)
+{
+  pthread_mutex_lock(&queue_writer_mutex);
+
+  while( queue_writer_busy != 0 || queue_writer_next != 0 )
+  {
+    pthread_cond_wait(&queue_writer_cond, &queue_writer_mutex);
+  }
+
+  pthread_mutex_unlock(&queue_writer_mutex);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_writer_start
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_writer_start(void)
+{
+  if( !queue_writer_running )
+  {
+    int rc;
+
+    queue_writer_quit = 0;
+
+    if( (rc = pthread_create(&queue_writer_tid, 0, queue_writer_thread, 0)) != 0 )
+    {
+      log_warning("writer thread: %s - saving synchronously\n",
+                  strerror(rc));
+    }
+    else
+    {
+      queue_writer_running = 1;
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_writer_stop  --  finish pending writes and stop writer thread
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_writer_stop(void)
+{
+  if( queue_writer_running )
+  {
+    pthread_mutex_lock(&queue_writer_mutex);
+    queue_writer_quit = 1;
+    pthread_cond_broadcast(&queue_writer_cond);
+    pthread_mutex_unlock(&queue_writer_mutex);
+
+    pthread_join(queue_writer_tid, 0);
+    queue_writer_running = 0;
+  }
+}
+
+/* ========================================================================= *
+ * journal functionality
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_journal_put  --  write one journal record to stream
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_journal_put(FILE *file, unsigned type, cookie_t cookie,
+                  int64_t value, const void *data, size_t size)
+{
+  queue_jrec_t rec =
+  {
+    .qj_type   = type,
+    .qj_cookie = cookie,
+    .qj_size   = size,
+    .qj_value  = value,
+  };
+
+  rec.qj_crc = xcrc32(0, &rec.qj_type, sizeof rec - sizeof rec.qj_crc);
+  rec.qj_crc = xcrc32(rec.qj_crc, data, size);
+
+  fwrite(&rec, sizeof rec, 1, file);
+  fwrite(data, size, 1, file);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_journal_put_event  --  write event content record to stream
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_journal_put_event(FILE *file, unsigned type, queue_node_t *node)
+{
+  size_t      size = 0;
+  const char *data = queue_node_get_text(node, &size);
+
+  queue_journal_put(file, type, node->qn_event->ALARMD_PRIVATE(cookie), 0,
+                    data, size);
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_journal_encode  --  generate records for pending changes
+ * ------------------------------------------------------------------------- */
+
+static
+int
+queue_journal_encode(char **pdata, size_t *psize)
+{
+  int   err  = -1;
+  FILE *file = 0;
+
+  if( (file = open_memstream(pdata, psize)) == 0 )
+  {
+    log_warning("%s: open: %s\n", "<ram>", strerror(errno));
+    goto cleanup;
+  }
+
+  if( queue->qc_journal_config )
   {
-    lo = INT_MIN;
+    queue_journal_put(file, QUEUE_JREC_CONFIG, 0, queue->qc_snooze, 0, 0);
   }
 
-  for( size_t i = queue_count; i--; )
+  for( size_t i = 0; i < queue->qc_pending_cnt; ++i )
   {
-    alarm_event_t *eve = queue_by_trigger[i];
+    cookie_t      cookie = queue->qc_pending[i];
+    queue_node_t *node   = queue_get_node(cookie);
 
-    /* Because alarms are no longer removed from queue
-     * immediately after "del_event" method call, we
-     * need to filter them out from client query results */
+    /* - - - - - - - - - - - - - - - - - - - *
+     * events that are no longer in the queue
+     * get deleted; full event content makes
+     * state & trigger records unnecessary
+     * - - - - - - - - - - - - - - - - - - - */
 
-    if( queue_event_get_state(eve) == ALARM_STATE_DELETED )
+    if( node == 0 )
     {
-      continue;
+      queue_journal_put(file, QUEUE_JREC_DELETE, cookie, 0, 0, 0);
     }
-
-    if( eve->ALARMD_PRIVATE(trigger) < lo ) continue;
-
-    if( eve->ALARMD_PRIVATE(trigger) > hi ) break;
-
-    if( (eve->flags & mask) != flag )
+    else if( node->qn_journal & (1u << QUEUE_JREC_ADD) )
     {
-      continue;
+      queue_journal_put_event(file, QUEUE_JREC_ADD, node);
     }
-
-    if( !xisempty(app) )
+    else if( node->qn_journal & (1u << QUEUE_JREC_UPDATE) )
+    {
+      queue_journal_put_event(file, QUEUE_JREC_UPDATE, node);
+    }
+    else
     {
-      if( (eve->alarm_appid == 0) || strcmp(eve->alarm_appid, app) )
+      if( node->qn_journal & (1u << QUEUE_JREC_STATE) )
       {
-        continue;
+        queue_journal_put(file, QUEUE_JREC_STATE, cookie,
+                          node->qn_event->flags, 0, 0);
+      }
+      if( node->qn_journal & (1u << QUEUE_JREC_TRIGGER) )
+      {
+        queue_journal_put(file, QUEUE_JREC_TRIGGER, cookie,
+                          node->qn_event->ALARMD_PRIVATE(trigger), 0, 0);
       }
     }
+  }
 
-    res[cnt++] = eve->ALARMD_PRIVATE(cookie);
+  if( ferror(file) == 0 )
+  {
+    err = 0;
   }
-  res[cnt] = 0;
 
-  if( pcnt ) *pcnt = cnt;
+  cleanup:
 
-  return res;
+  if( file != 0 && fclose(file) == EOF )
+  {
+    err = -1;
+  }
+
+  return err;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_query_by_state
+ * queue_journal_forget  --  drop pending changes
  * ------------------------------------------------------------------------- */
 
-cookie_t *
-queue_query_by_state(int *pcnt, unsigned state)
+static
+void
+queue_journal_forget(void)
 {
-  cookie_t *res = calloc(queue_count+1, sizeof *res);
-  size_t    cnt = 0;
-
-  for( size_t i = queue_count; i--; )
+  for( size_t i = 0; i < queue->qc_pending_cnt; ++i )
   {
-    alarm_event_t *eve = queue_by_trigger[i];
-
-    if( eve->flags & ALARM_EVENT_DISABLED )
-    {
-      continue;
-    }
+    queue_node_t *node = queue_get_node(queue->qc_pending[i]);
 
-    if( queue_event_get_state(eve) == state )
+    if( node != 0 )
     {
-      res[cnt++] = eve->ALARMD_PRIVATE(cookie);
+      node->qn_journal = 0;
     }
   }
-  res[cnt] = 0;
-
-  if( pcnt ) *pcnt = cnt;
-
-  return res;
+  queue->qc_pending_cnt    = 0;
+  queue->qc_journal_config = 0;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_count_by_state
+ * queue_journal_append  --  write pending changes to journal file
  * ------------------------------------------------------------------------- */
 
+static
 int
-queue_count_by_state(unsigned state)
+queue_journal_append(void)
 {
-  int cnt = 0;
+  int     result = -1;
+  char   *data   = 0;
+  size_t  size   = 0;
 
-  for( size_t i = queue_count; i--; )
+  if( queue->qc_pending_cnt == 0 && !queue->qc_journal_config )
   {
-    alarm_event_t *eve = queue_by_trigger[i];
+    result = 0;
+  }
+  else if( queue_journal_encode(&data, &size) != -1 )
+  {
+    queue_write_t *job = queue_write_create();
 
-    if( eve->flags & ALARM_EVENT_DISABLED )
-    {
-      continue;
-    }
+    job->qw_jnl      = data, data = 0;
+    job->qw_jnl_size = size;
+    queue_writer_submit(job);
 
-    if( queue_event_get_state(eve) == state )
-    {
-      cnt += 1;
-    }
+    queue->qc_journal_size += size;
+    queue_journal_forget();
+    result = 1;
   }
 
-  return cnt;
+  free(data);
+
+  return result;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_count_by_state_and_flag
+ * queue_journal_reset  --  start empty journal for snapshot generation
  * ------------------------------------------------------------------------- */
 
-int
-queue_count_by_state_and_flag   (unsigned state, unsigned flag)
+static
+void
+queue_journal_reset(queue_write_t *job, unsigned gen)
 {
-  int cnt = 0;
+  FILE *file = 0;
 
-  for( size_t i = queue_count; i--; )
-  {
-    alarm_event_t *eve = queue_by_trigger[i];
+  queue->qc_journal_gen  = gen;
+  queue->qc_journal_ok   = 0;
+  queue->qc_journal_size = 0;
 
-    if( eve->flags & ALARM_EVENT_DISABLED )
-    {
-      continue;
-    }
+  if( (file = open_memstream(&job->qw_jnl, &job->qw_jnl_size)) != 0 )
+  {
+    queue_journal_put(file, QUEUE_JREC_HEAD, 0, gen, 0, 0);
 
-    if( queue_event_get_state(eve) == state && eve->flags & flag )
+    if( fclose(file) != EOF )
     {
-      cnt += 1;
+      job->qw_reset          = 1;
+      queue->qc_journal_ok   = 1;
+      queue->qc_journal_size = job->qw_jnl_size;
     }
   }
-
-  return cnt;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_cleanup_deleted
+ * queue_journal_replay  --  apply journal records on top of snapshot
  * ------------------------------------------------------------------------- */
 
+static
 void
-queue_cleanup_deleted(void)
+queue_journal_replay(queue_ctx_t *ctx, unsigned gen)
 {
-  size_t t = 0;
-  size_t c = 0;
+  queue_ctx_t *prev = queue_ctx_select(ctx);
+  char        *data = 0;
+  size_t       size = 0;
+  size_t       done = 0;
+  int          cnt  = 0;
+
+  queue->qc_journal_gen  = gen;
+  queue->qc_journal_ok   = 0;
+  queue->qc_journal_size = 0;
+
+  if( access(QUEUE_JOURNAL, F_OK) == -1 ||
+      xloadfile(QUEUE_JOURNAL, &data, &size) == -1 )
+  {
+    goto cleanup;
+  }
 
-  for( size_t i = 0; i < queue_count; ++i )
+  while( size - done >= sizeof(queue_jrec_t) )
   {
-    alarm_event_t *eve = queue_by_trigger[i];
+    queue_jrec_t  rec;
+    const char   *pay = data + done + sizeof rec;
 
-    switch( queue_event_get_state(eve) )
+    memcpy(&rec, data + done, sizeof rec);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * stop at the first truncated or corrupted
+     * record, i.e. where write was interrupted
+     * - - - - - - - - - - - - - - - - - - - */
+
+    if( rec.qj_size > size - done - sizeof rec )
     {
-    case ALARM_STATE_DELETED:
-    case ALARM_STATE_FINALIZED:
-      //log_debug("T:%03Zd\t%ld\n", i, (long)eve->ALARMD_PRIVATE(cookie));
-      queue_event_set_state(eve, ALARM_STATE_FINALIZED);
       break;
+    }
 
-    default:
-      queue_by_trigger[t++] = eve;
+    uint32_t crc = xcrc32(0, &rec.qj_type, sizeof rec - sizeof rec.qj_crc);
+    crc = xcrc32(crc, pay, rec.qj_size);
+
+    if( crc != rec.qj_crc )
+    {
       break;
     }
-  }
 
-  for( size_t i = 0; i < queue_count; ++i )
-  {
-    alarm_event_t *eve = queue_by_cookie[i];
-    switch( queue_event_get_state(eve) )
+    /* - - - - - - - - - - - - - - - - - - - *
+     * journal must belong to the snapshot
+     * - - - - - - - - - - - - - - - - - - - */
+
+    if( done == 0 )
     {
-    case ALARM_STATE_DELETED:
-    case ALARM_STATE_FINALIZED:
-      //log_debug("C:%03Zd\t%ld\n", i, (long)eve->ALARMD_PRIVATE(cookie));
-      alarm_event_delete(eve);
+      if( rec.qj_type != QUEUE_JREC_HEAD || rec.qj_value != gen )
+      {
+        log_warning("%s: generation mismatch - ignored\n", QUEUE_JOURNAL);
+        goto cleanup;
+      }
+      done += sizeof rec;
+      continue;
+    }
+
+    done += sizeof rec + rec.qj_size;
+    cnt  += 1;
+
+    queue_node_t *node = queue_get_node(rec.qj_cookie);
+
+    switch( rec.qj_type )
+    {
+    case QUEUE_JREC_ADD:
+    case QUEUE_JREC_UPDATE:
+      {
+        inifile_t *ini = inifile_create();
+        if( inifile_load_from_memory(ini, pay, rec.qj_size) != -1 )
+        {
+          queue_load_from_ini(ini);
+        }
+        inifile_delete(ini);
+      }
       break;
 
-    default:
-      queue_by_cookie[c++] = eve;
+    case QUEUE_JREC_DELETE:
+      if( node != 0 )
+      {
+        queue_remove_node(node);
+      }
       break;
-    }
-  }
 
-  assert( c == t );
+    case QUEUE_JREC_STATE:
+      if( node != 0 )
+      {
+        queue_state_unlink(node, queue_event_get_state(node->qn_event));
+        node->qn_event->flags = rec.qj_value;
+        node->qn_text_ok = 0;
+        queue_state_link(node, queue_event_get_state(node->qn_event));
+        queue_stat_refresh(node);
+      }
+      break;
 
-  queue_count = c;
-}
+    case QUEUE_JREC_TRIGGER:
+      if( node != 0 )
+      {
+        node->qn_event->ALARMD_PRIVATE(trigger) = rec.qj_value;
+        node->qn_text_ok = 0;
+        queue_heap_update(node->qn_heap);
+        queue->qc_order_ok = 0;
+      }
+      break;
 
-/* ------------------------------------------------------------------------- *
- * queue_flush_events  --  delete all events without performing actions
- * ------------------------------------------------------------------------- */
+    case QUEUE_JREC_CONFIG:
+      queue_set_snooze(rec.qj_value);
+      break;
 
-static void
-queue_flush_events(void)
-{
-  // delete events directly, without state
-  // transitions and action execution
-  for( size_t i = 0; i < queue_count; ++i )
+    default:
+      log_warning("%s: unknown record type %u\n", QUEUE_JOURNAL,
+                  (unsigned)rec.qj_type);
+      break;
+    }
+  }
+
+  if( done != size )
+  {
+    log_warning("%s: %zu bytes of garbage at end\n", QUEUE_JOURNAL,
+                size - done);
+  }
+  else if( done != 0 )
   {
-    alarm_event_delete(queue_by_cookie[i]);
+    queue->qc_journal_ok   = 1;
+    queue->qc_journal_size = done;
   }
 
-  // free event tables
-  free(queue_by_cookie);
-  free(queue_by_trigger);
+  log_info("%s: %d records replayed\n", QUEUE_JOURNAL, cnt);
 
-  // clear related values
-  queue_by_cookie  = 0;
-  queue_by_trigger = 0;
-  queue_count      = 0;
-  queue_alloc      = 0;
-}
+  cleanup:
 
-/* ========================================================================= *
- * persistent storage functionality
- * ========================================================================= */
+  free(data);
+
+  queue_ctx_select(prev);
+}
 
 /* ------------------------------------------------------------------------- *
- * queue_save_to_memory
+ * queue_journal_compact  --  write snapshot and start a new journal
  * ------------------------------------------------------------------------- */
 
 static
 int
-queue_save_to_memory(char **pdata, size_t *psize)
+queue_journal_compact(void)
 {
-  int        err = -1;
-  inifile_t *ini = inifile_create();
+  int     result = -1;
+  char   *data   = 0;
+  size_t  size   = 0;
+  uint64_t hash  = 0;
+  unsigned gen   = queue->qc_journal_gen + 1;
 
-  inifile_setfmt(ini, "config", "snooze", "%u", queue_snooze);
+  queue_write_t *job = 0;
 
-  auto void xu(unsigned           v, const char *s, const char *f, ...);
-  auto void xq(unsigned long long v, const char *s, const char *f, ...);
-  auto void xi(int                v, const char *s, const char *f, ...);
-  auto void xs(const char        *v, const char *s, const char *f, ...);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * nothing to do if the snapshot is up to
+   * date and the journal empty
+   * - - - - - - - - - - - - - - - - - - - */
 
-  auto void xu(unsigned v, const char *s, const char *f, ...)
+  if( queue->qc_journal_ok &&
+      queue->qc_journal_size == sizeof(queue_jrec_t) &&
+      queue->qc_pending_cnt == 0 && !queue->qc_journal_config )
   {
-    if( v != 0 )
-    {
-      va_list va;
-      char k[64];
-      va_start(va, f);
-      vsnprintf(k, sizeof k, f, va);
-      va_end(va);
-      inifile_setfmt(ini, s, k, "%u", v);
-    }
+    result = 0;
+    goto cleanup;
   }
 
-  auto void xq(unsigned long long v, const char *s, const char *f, ...)
-  {
-    if( v != 0 )
-    {
-      va_list va;
-      char k[64];
-      va_start(va, f);
-      vsnprintf(k, sizeof k, f, va);
-      va_end(va);
-      inifile_setfmt(ini, s, k, "%llu", v);
-    }
-  }
-  auto void xi(int v, const char *s, const char *f, ...)
-  {
-    if( v != 0 )
-    {
-      va_list va;
-      char k[64];
-      va_start(va, f);
-      vsnprintf(k, sizeof k, f, va);
-      va_end(va);
-      inifile_setfmt(ini, s, k, "%d", v);
-    }
-  }
-  auto void xs(const char *v, const char *s, const char *f, ...)
-  {
-    if( v && *v )
-    {
-      va_list va;
-      char k[64];
-      va_start(va, f);
-      vsnprintf(k, sizeof k, f, va);
-      va_end(va);
-      inifile_setfmt(ini, s, k, "%s", v);
-    }
-  }
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the snapshot is written with the next
+   * generation number -> the old journal no
+   * longer applies even if we fail to reset
+   * it afterwards
+   * - - - - - - - - - - - - - - - - - - - */
 
-  for( size_t i = 0; i < queue_count; ++i )
+  if( queue_save_to_memory(&data, &size, gen, &hash) == -1 )
   {
-    alarm_event_t *e = queue_by_cookie[i];
-
-    char sec[32];
-
-    snprintf(sec, sizeof sec, "#%08x", (unsigned)e->ALARMD_PRIVATE(cookie));
-
-#define Xu2(n,v) xu(e->v, sec, #n)
-#define Xi2(n,v) xi(e->v, sec, #n)
-#define Xs2(n,v) xs(e->v, sec, #n)
+    goto cleanup;
+  }
 
-#define Xu(v) Xu2(v,v)
-#define Xi(v) Xi2(v,v)
-#define Xs(v) Xs2(v,v)
+  /* - - - - - - - - - - - - - - - - - - - *
+   * if the content matches the snapshot we
+   * wrote last and the file has not been
+   * touched since, starting a new journal
+   * for it is enough
+   * - - - - - - - - - - - - - - - - - - - */
 
-    Xu2(cookie,  ALARMD_PRIVATE(cookie));
-    Xi2(trigger, ALARMD_PRIVATE(trigger));
+  job = queue_write_create();
 
-    Xs(title);
-    Xs(message);
-    Xs(sound);
-    Xs(icon);
-    Xu(flags);
+  if( queue_writer_jobs == 0 && queue_snap_ok && queue_snap_hash == hash &&
+      xcheckstats(QUEUE_DATABASE, &queue_snap_stat) )
+  {
+    queue_journal_forget();
+    queue_journal_reset(job, queue->qc_journal_gen);
+  }
+  else
+  {
+    job->qw_ini      = data, data = 0;
+    job->qw_ini_size = size;
+    job->qw_hash     = hash;
 
-    Xs(alarm_appid);
+    queue_bin_encode(gen, &job->qw_bin, &job->qw_bin_size);
 
-    Xi(alarm_time);
+    queue_snap_ok   = 0;
+    queue_snap_hash = hash;
 
-    Xi(alarm_tm.tm_year);
-    Xi(alarm_tm.tm_mon);
-    Xi(alarm_tm.tm_mday);
-    Xi(alarm_tm.tm_hour);
-    Xi(alarm_tm.tm_min);
-    Xi(alarm_tm.tm_sec);
-    Xi(alarm_tm.tm_wday);
-    Xi(alarm_tm.tm_yday);
-    Xi(alarm_tm.tm_isdst);
+    queue_journal_forget();
+    queue_journal_reset(job, gen);
+  }
 
-    Xs(alarm_tz);
+  queue_writer_submit(job);
 
-    Xi(recur_secs);
-    Xi(recur_count);
+  result = 1;
 
-    Xi(snooze_secs);
-    Xi(snooze_total);
+  cleanup:
 
-    Xu(action_cnt);
-    Xu(recurrence_cnt);
-    Xu(attr_cnt);
+  free(data);
 
-#undef Xu
-#undef Xi
-#undef Xs
+  return result;
+}
 
-#undef Xu2
-#undef Xi2
-#undef Xs2
+/* ========================================================================= *
+ * external modification functionality
+ * ========================================================================= */
 
-    for( size_t i = 0; i < e->action_cnt; ++i )
-    {
-      alarm_action_t  *a= &e->action_tab[i];
+/* ------------------------------------------------------------------------- *
+ * queue_merge_cmp_cookie_cb
+ * ------------------------------------------------------------------------- */
 
-#define Xu(v) xu(a->v, sec, "action%d."#v, (int)i)
-#define Xs(v) xs(a->v, sec, "action%d."#v, (int)i)
+static
+int
+queue_merge_cmp_cookie_cb(const void *a1, const void *a2)
+{
+  cookie_t c1 = *(const cookie_t *)a1;
+  cookie_t c2 = *(const cookie_t *)a2;
+  return (c1 > c2) - (c1 < c2);
+}
 
-      Xu(flags);
-      Xs(label);
-      Xs(exec_command);
-      Xs(dbus_interface);
-      Xs(dbus_service);
-      Xs(dbus_path);
-      Xs(dbus_name);
-      Xs(dbus_args);
+/* ------------------------------------------------------------------------- *
+ * queue_merge_is_same  --  event equals queued one apart from state
+ * ------------------------------------------------------------------------- */
 
-#undef Xu
-#undef Xs
-    }
+static
+int
+queue_merge_is_same(alarm_event_t *e, queue_node_t *node)
+{
+  unsigned    flags = e->flags;
+  iniwriter_t out;
+  char       *data  = 0;
+  size_t      size  = 0;
+  size_t      have  = 0;
+  const char *text  = queue_node_get_text(node, &have);
 
-    for( size_t i = 0; i < e->recurrence_cnt; ++i )
-    {
-      alarm_recur_t  *r= &e->recurrence_tab[i];
+  e->flags = ((flags & ALARM_EVENT_CLIENT_MASK) |
+              (node->qn_event->flags & ~ALARM_EVENT_CLIENT_MASK));
 
-#define Xu(v) xu(r->v, sec, "recurrence_tab%d."#v, (int)i)
-#define Xq(v) xq(r->v, sec, "recurrence_tab%d."#v, (int)i)
+  iniwriter_ctor(&out);
+  queue_event_to_writer(&out, e);
+  data = iniwriter_steal(&out, &size);
+  iniwriter_dtor(&out);
 
-      Xq(mask_min);
-      Xu(mask_hour);
-      Xu(mask_mday);
-      Xu(mask_wday);
-      Xu(mask_mon);
-      Xu(special);
+  e->flags = flags;
 
-#undef Xu
-#undef Xq
-    }
+  int same = (size == have && !memcmp(data, text, size));
 
-    for( size_t i = 0; i < e->attr_cnt; ++i )
-    {
-      alarm_attr_t  *a= e->attr_tab[i];
+  free(data);
 
-#define Xi(v) xi(a->v, sec, "attr%d."#v, (int)i)
-#define Xs(v) xs(a->v, sec, "attr%d."#v, (int)i)
+  return same;
+}
 
-      Xs(attr_name);
-      Xi(attr_type);
-      switch( a->attr_type )
-      {
-      case ALARM_ATTR_NULL:
-        break;
-      case ALARM_ATTR_INT:
-        Xi(attr_data.ival);
-        break;
-      case ALARM_ATTR_TIME:
-        Xi(attr_data.tval);
-        break;
-      case ALARM_ATTR_STRING:
-        Xs(attr_data.sval);
-        break;
-      }
-#undef Xi
-#undef Xs
-    }
+/* ------------------------------------------------------------------------- *
+ * queue_merge_copy_event  --  copy of side queue event for live queue
+ * ------------------------------------------------------------------------- */
 
+static
+alarm_event_t *
+queue_merge_copy_event(queue_node_t *node)
+{
+  alarm_event_t *e    = 0;
+  inifile_t     *ini  = inifile_create();
+  char         **secs = 0;
+  size_t         size = 0;
+  const char    *text = queue_node_get_text(node, &size);
+
+  if( inifile_load_from_memory(ini, text, size) != -1 &&
+      (secs = inifile_get_section_names(ini, 0)) != 0 && secs[0] != 0 )
+  {
+    e = queue_event_from_ini(ini, secs[0]);
   }
 
-  err = inifile_save_to_memory(ini, pdata, psize);
+  xfreev(secs);
   inifile_delete(ini);
 
-  return err;
+  return e;
 }
 
 /* ------------------------------------------------------------------------- *
- * queue_load_from_path
+ * queue_merge_replace_node  --  remove live event that is to be replaced
  * ------------------------------------------------------------------------- */
 
 static
 void
-queue_load_from_path(const char *path)
+queue_merge_replace_node(queue_node_t *node)
 {
-  char      **secs = 0;
-  inifile_t  *ini  = inifile_create();
-  unsigned    snooze = 0;
-
-  if( inifile_load(ini, path) == -1 )
+  /* system ui dialogs shown for the event must be dismissed */
+  switch( queue_event_get_state(node->qn_event) )
   {
-    log_warning("%s: load failed\n", path);
-    goto cleanup;
+  case ALARM_STATE_WAITSYSUI:
+  case ALARM_STATE_SYSUI_REQ:
+  case ALARM_STATE_SYSUI_ACK:
+  case ALARM_STATE_SYSUI_RSP:
+    queue_replaced = realloc(queue_replaced,
+                             (queue_replaced_cnt + 1) * sizeof *queue_replaced);
+    queue_replaced[queue_replaced_cnt++] = node->qn_event->ALARMD_PRIVATE(cookie);
+    break;
   }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * parse data from save file
-   * - - - - - - - - - - - - - - - - - - - */
-
-  inifile_getfmt(ini, "config", "snooze", "%u", &snooze);
-  queue_set_snooze(snooze);
+  queue_remove_node(node);
+}
 
-  if( (secs = inifile_get_section_names(ini, 0)) != 0 )
-  {
-    for( size_t i = 0; secs[i]; ++i )
-    {
-      const char *sec = secs[i];
+/* ------------------------------------------------------------------------- *
+ * queue_take_replaced  --  cookies of replaced events system ui may show
+ * ------------------------------------------------------------------------- */
 
-      if( *sec != '#' ) continue;
+cookie_t *
+queue_take_replaced(int *pcnt)
+{
+  cookie_t *vec = queue_replaced;
 
-      alarm_event_t *e = alarm_event_create();
+  *pcnt = queue_replaced_cnt;
 
-      size_t cnt;
+  queue_replaced     = 0;
+  queue_replaced_cnt = 0;
 
-      if( inifile_getfmt(ini, sec, "action_cnt", "%zi", &cnt) == 1 )
-      {
-        alarm_event_add_actions(e, cnt);
-      }
-      if( inifile_getfmt(ini, sec, "recurrence_cnt", "%zi", &cnt) == 1 )
-      {
-        alarm_event_add_recurrences(e, cnt);
-      }
+  return vec;
+}
 
-#define Xu2(n,v) e->v = strtoul(inifile_get(ini, sec, #n, ""),0,0)
-#define Xi2(n,v) e->v = strtol(inifile_get(ini, sec, #n, ""),0,0)
-#define Xs2(n,v) xstrset(&(e->v), inifile_get(ini, sec, #n, ""))
+/* ------------------------------------------------------------------------- *
+ * queue_merge_from_path  --  apply differences between file and queue
+ * ------------------------------------------------------------------------- */
 
-#define Xu(v) Xu2(v,v)
-#define Xi(v) Xi2(v,v)
-#define Xs(v) Xs2(v,v)
+static
+void
+queue_merge_from_path(const char *path)
+{
+  queue_ctx_t side;
+  cookie_t   *seen  = 0;
+  size_t      count = 0;
+  unsigned    gen   = 0;
 
-      Xu2(cookie,  ALARMD_PRIVATE(cookie));
-      Xi2(trigger, ALARMD_PRIVATE(trigger));
+  int added = 0, changed = 0, removed = 0, same = 0;
 
-      Xs(title);
-      Xs(message);
-      Xs(sound);
-      Xs(icon);
-      Xu(flags);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the file and the journal that goes
+   * with it are loaded to a side queue,
+   * which is then compared against the
+   * live queue; only new and changed
+   * events are taken
+   * - - - - - - - - - - - - - - - - - - - */
 
-      Xs(alarm_appid);
+  /* events without cookie get new ones from the side queue,
+   * which must not collide with the ones in the live queue */
 
-      Xi(alarm_time);
+  queue_ctx_init(&side);
+  side.qc_cookie = queue->qc_cookie;
 
-      Xi(alarm_tm.tm_year);
-      Xi(alarm_tm.tm_mon);
-      Xi(alarm_tm.tm_mday);
-      Xi(alarm_tm.tm_hour);
-      Xi(alarm_tm.tm_min);
-      Xi(alarm_tm.tm_sec);
-      Xi(alarm_tm.tm_wday);
-      Xi(alarm_tm.tm_yday);
-      Xi(alarm_tm.tm_isdst);
+  if( queue_load_from_path(&side, path, &gen) == -1 )
+  {
+    goto cleanup;
+  }
 
-      Xs(alarm_tz);
+  queue_journal_replay(&side, gen);
 
-      Xi(recur_secs);
-      Xi(recur_count);
+  gen = side.qc_journal_gen;
+  queue_set_snooze(side.qc_snooze);
 
-      Xi(snooze_secs);
-      Xi(snooze_total);
+  seen = calloc(side.qc_count + 1, sizeof *seen);
 
-#undef Xu
-#undef Xi
-#undef Xs
+  for( size_t i = 0; i < side.qc_count; ++i )
+  {
+    queue_node_t  *from   = side.qc_by_trigger[i];
+    cookie_t       cookie = from->qn_event->ALARMD_PRIVATE(cookie);
+    queue_node_t  *node   = queue_get_node(cookie);
+    alarm_event_t *e      = 0;
 
-#undef Xu2
-#undef Xi2
-#undef Xs2
+    if( cookie == 0 ||
+        queue_event_get_state(from->qn_event) == ALARM_STATE_DELETED )
+    {
+      continue;
+    }
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * action table
-       * - - - - - - - - - - - - - - - - - - - */
+    seen[count++] = cookie;
 
-      for( size_t k = 0; k < e->action_cnt; ++k )
-      {
-        alarm_action_t  *a = &e->action_tab[k];
-        char key[64];
+    if( node == 0 )
+    {
+      added += 1;
+    }
+    else if( queue_merge_is_same(from->qn_event, node) )
+    {
+      same += 1;
+      continue;
+    }
+    else
+    {
+      queue_merge_replace_node(node);
+      changed += 1;
+    }
 
-#define Xu(v) \
-  snprintf(key, sizeof key, "action%d.%s", (int)k, #v);\
-  a->v = strtoul(inifile_get(ini, sec, key, ""),0,0)
+    if( (e = queue_merge_copy_event(from)) != 0 )
+    {
+      queue_add_event(e);
+      queue_load_normalize_event(e);
+    }
+  }
 
-#define Xs(v)\
-  snprintf(key, sizeof key, "action%d.%s", (int)k, #v);\
-  xstrset(&a->v, inifile_get(ini, sec, key, ""))
+  /* - - - - - - - - - - - - - - - - - - - *
+   * events missing from the file are
+   * deleted the normal way
+   * - - - - - - - - - - - - - - - - - - - */
 
-        Xu(flags);
-        Xs(label);
-        Xs(exec_command);
-        Xs(dbus_interface);
-        Xs(dbus_service);
-        Xs(dbus_path);
-        Xs(dbus_name);
-        Xs(dbus_args);
+  qsort(seen, count, sizeof *seen, queue_merge_cmp_cookie_cb);
 
-#undef Xu
-#undef Xs
-      }
+  cookie_t *gone = calloc(queue->qc_count + 1, sizeof *gone);
+  size_t    ngone = 0;
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * recurrence table
-       * - - - - - - - - - - - - - - - - - - - */
+  for( size_t i = 0; i < queue->qc_count; ++i )
+  {
+    alarm_event_t *e      = queue->qc_by_trigger[i]->qn_event;
+    cookie_t       cookie = e->ALARMD_PRIVATE(cookie);
 
-      for( size_t k = 0; k < e->recurrence_cnt; ++k )
-      {
-        alarm_recur_t  *r = &e->recurrence_tab[k];
-        char key[64];
+    if( queue_event_get_state(e) != ALARM_STATE_DELETED &&
+        !bsearch(&cookie, seen, count, sizeof *seen, queue_merge_cmp_cookie_cb) )
+    {
+      gone[ngone++] = cookie;
+    }
+  }
 
-#define Xu(v) \
-  snprintf(key, sizeof key, "recurrence_tab%d.%s", (int)k, #v);\
-  r->v = strtoul(inifile_get(ini, sec, key,  ""),0,0)
+  for( size_t i = 0; i < ngone; ++i )
+  {
+    queue_del_event(gone[i]);
+    removed += 1;
+  }
+  free(gone);
 
-#define Xq(v)\
-  snprintf(key, sizeof key, "recurrence_tab%d.%s", (int)k, #v);\
-  r->v = strtoull(inifile_get(ini, sec, key,  ""),0,0)
+  log_notice("%s: merged: %d added, %d changed, %d removed, %d unchanged\n",
+             path, added, changed, removed, same);
 
-        Xq(mask_min);
-        Xu(mask_hour);
-        Xu(mask_mday);
-        Xu(mask_wday);
-        Xu(mask_mon);
-        Xu(special);
+  cleanup:
 
-#undef Xu
-#undef Xq
-      }
+  queue_flush_events(&side);
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * attribute table
-       * - - - - - - - - - - - - - - - - - - - */
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the journal changes are now part of
+   * the live queue; the next save rewrites
+   * the snapshot completely with a
+   * generation neither the file nor the
+   * journals have used
+   * - - - - - - - - - - - - - - - - - - - */
 
-      if( inifile_getfmt(ini, sec, "attr_cnt", "%zi", &cnt) != 1 )
-      {
-        cnt = 0;
-      }
+  queue_journal_forget();
+  if( queue->qc_journal_gen < gen )
+  {
+    queue->qc_journal_gen = gen;
+  }
+  queue->qc_journal_ok = 0;
+  queue_snap_ok        = 0;
 
-      for( size_t k = 0; k < cnt; ++k )
-      {
-        alarm_attr_t  *a = alarm_event_add_attr(e, "\x7f");
-        char key[64];
+  xfetchstats(path, &queue_save_stat);
 
-#define Xi(v) \
-  snprintf(key, sizeof key, "attr%d.%s", (int)k, #v);\
-  a->v = strtol(inifile_get(ini, sec, key, ""),0,0)
+  free(seen);
 
-#define Xs(v)\
-  snprintf(key, sizeof key, "attr%d.%s", (int)k, #v);\
-  xstrset(&a->v, inifile_get(ini, sec, key, ""))
+  queue_set_dirty();
+  queue_indicate_modified();
+}
 
-        Xs(attr_name);
-        Xi(attr_type);
+/* ------------------------------------------------------------------------- *
+ * queue_check_external  --  merge queue file if modified by others
+ * ------------------------------------------------------------------------- */
 
-        switch( a->attr_type )
-        {
-        case ALARM_ATTR_NULL:
-          break;
-        case ALARM_ATTR_INT:
-          Xi(attr_data.ival);
-          break;
-        case ALARM_ATTR_TIME:
-          Xi(attr_data.tval);
-          break;
-        case ALARM_ATTR_STRING:
-          Xs(attr_data.sval);
-          break;
-        }
-#undef Xi
-#undef Xs
-      }
+static
+void
+queue_check_external(void)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * own writes that have not been picked
+   * up yet can't be told apart from other
+   * modifications -> check when finished
+   * - - - - - - - - - - - - - - - - - - - */
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * add to queue
-       * - - - - - - - - - - - - - - - - - - - */
+  if( queue_writer_jobs != 0 )
+  {
+    queue_watch_pending = 1;
+    return;
+  }
+  queue_watch_pending = 0;
 
-      switch( queue_event_get_state(e) )
-      {
-      case ALARM_STATE_LIMBO:
-      case ALARM_STATE_TRIGGERED:
-      case ALARM_STATE_WAITSYSUI:
-      case ALARM_STATE_SYSUI_REQ:
-      case ALARM_STATE_SYSUI_ACK:
-      case ALARM_STATE_SYSUI_RSP:
-        // put alarms that were in triggered state
-        // back to limbo so that we have a chance
-        // to evaluate conditions and perform actions
-        // again
-        queue_event_set_state(e, ALARM_STATE_LIMBO);
-        break;
-
-      default:
-        queue_event_set_state(e, ALARM_STATE_NEW);
-        break;
-      }
+  if( !xcheckstats(QUEUE_DATABASE, &queue_save_stat) )
+  {
+    log_critical("ALARM DB CHANGED SINCE LAST SAVE"
+                 " - merging changes\n");
 
-#if 0 // disabled: rejecting events on load might cause regression
-      if( alarm_event_is_sane(e) != -1 )
-      {
-        queue_add_event(e), e = 0;
-      }
-      alarm_event_delete(e);
-#else
-      //alarm_event_is_sane(e);
-      queue_add_event(e);
-#endif
-    }
+    queue_merge_from_path(QUEUE_DATABASE);
   }
+}
 
-  cleanup:
+/* ------------------------------------------------------------------------- *
+ * queue_save_account  --  update & log statistics
+ * ------------------------------------------------------------------------- */
 
-  xfreev(secs);
-  inifile_delete(ini);
+static
+void
+queue_save_account(int result)
+{
+  switch( result )
+  {
+  case 2:  queue_stat_journaled += 1; break;
+  case 1:  queue_stat_saved     += 1; break;
+  case 0:  queue_stat_skipped   += 1; break;
+  default: queue_stat_failed    += 1; break;
+  }
+
+  log_info("queue save: %s -> saved=%u, journaled=%u, skipped=%u, failed=%u\n",
+           (result==0) ? "SKIP" : (result==1) ? "SAVE" :
+           (result==2) ? "JRNL" : "FAIL",
+           queue_stat_saved, queue_stat_journaled,
+           queue_stat_skipped, queue_stat_failed);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -1225,20 +4814,21 @@ queue_save_internal(int forced)
 {
   static int restored = 0;
 
-  static int skip_cnt = 0;
-  static int save_cnt = 0;
-  static int fail_cnt = 0;
-
   int        result   = -1;
-  char      *old_data = 0;
-  char      *new_data = 0;
-  size_t     old_size = 0;
-  size_t     new_size = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * pick up results of earlier writes
+   * - - - - - - - - - - - - - - - - - - - */
+
+  queue_save_finish();
 
   /* - - - - - - - - - - - - - - - - - - - *
    * try to deal with osso-backup restoring
    * the database without stopping or
    * signaling alarmd first ...
+   *
+   * the file can't be checked while our
+   * own writes to it are still in progress
    * - - - - - - - - - - - - - - - - - - - */
 
   if( forced != 0 )
@@ -1254,7 +4844,20 @@ queue_save_internal(int forced)
       goto cleanup;
     }
 
-    if( !xcheckstats(QUEUE_DATABASE, &queue_save_stat) )
+#if ALARMD_QUEUE_MODIFIED_MERGE
+    /* - - - - - - - - - - - - - - - - - - - *
+     * changes are merged as soon as they are
+     * reported by the directory watch; check
+     * here only if watching is not possible
+     * - - - - - - - - - - - - - - - - - - - */
+
+    if( queue_watch_fd == -1 )
+    {
+      queue_check_external();
+    }
+#else
+    if( queue_writer_jobs == 0 &&
+        !xcheckstats(QUEUE_DATABASE, &queue_save_stat) )
     {
       log_critical("ALARM DB CHANGED SINCE LAST SAVE"
                    " - assuming restore from backup\n");
@@ -1264,63 +4867,116 @@ queue_save_internal(int forced)
 
       goto cleanup;
     }
+#endif
   }
 
   /* - - - - - - - - - - - - - - - - - - - *
    * try really hard to avoid writing to
    * flash file system
    *
-   * 1) load previous contents to RAM
-   * 2) generate current contents in RAM
-   * 3) write only if the two differ
+   * 1) normally just append the changes
+   *    made since the last save to journal
+   * 2) rewrite the whole snapshot only when
+   *    forced, the journal has grown too
+   *    large or is not usable
+   *
+   * the data is handed over to the writer
+   * thread, results are accounted for in
+   * queue_save_finish()
    * - - - - - - - - - - - - - - - - - - - */
 
-  xloadfile(QUEUE_DATABASE, &old_data, &old_size);
-  queue_save_to_memory(&new_data, &new_size);
-
-  if( old_size != new_size || memcmp(old_data, new_data, new_size) )
+  if( !forced && queue->qc_journal_ok && queue->qc_journal_size < QUEUE_JOURNAL_LIMIT )
   {
-    if( xsavefile(QUEUE_TEMPSAVE, 0666, new_data, new_size) == 0 &&
-        xcyclefiles(QUEUE_TEMPSAVE, QUEUE_DATABASE, QUEUE_BACKUP) == 0 )
+    if( (result = queue_journal_append()) != -1 )
     {
-      result = 1;
+      goto cleanup;
     }
+    queue->qc_journal_ok = 0;
   }
-  else
+
+  result = queue_journal_compact();
+
+  cleanup:
+
+  if( result != 1 )
   {
-    result = 0;
+    queue_save_account(result);
   }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * update "current content" stats
+   * without writer thread the results are
+   * already available
    * - - - - - - - - - - - - - - - - - - - */
 
-  xfetchstats(QUEUE_DATABASE, &queue_save_stat);
+  if( !queue_writer_running )
+  {
+    queue_save_finish();
+  }
+}
 
-  cleanup:
+/* ------------------------------------------------------------------------- *
+ * queue_save_finish  --  account for writes finished in the background
+ * ------------------------------------------------------------------------- */
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * update & log statistics
-   * - - - - - - - - - - - - - - - - - - - */
+int
+queue_save_finish(void)
+{
+  int            err  = 0;
+  queue_write_t *done = 0;
 
-  switch( result )
+  pthread_mutex_lock(&queue_writer_mutex);
+  done = queue_writer_done, queue_writer_done = 0;
+  pthread_mutex_unlock(&queue_writer_mutex);
+
+  while( done != 0 )
   {
-  case 1:  save_cnt += 1; break;
-  case 0:  skip_cnt += 1; break;
-  default: fail_cnt += 1; break;
-  }
+    queue_write_t *self = done;
+
+    done = self->qw_next;
+    queue_writer_jobs -= 1;
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * update "current content" stats
+     * - - - - - - - - - - - - - - - - - - - */
+
+    if( self->qw_ini_ok )
+    {
+      queue_save_stat = self->qw_stat;
+
+      if( self->qw_result == 1 && self->qw_hash == queue_snap_hash )
+      {
+        queue_snap_stat = self->qw_stat;
+        queue_snap_ok   = 1;
+      }
+    }
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * after failures the snapshot needs to
+     * be rewritten on the next save
+     * - - - - - - - - - - - - - - - - - - - */
 
-  log_info("queue save: %s -> saved=%d, skipped=%d, failed=%d\n",
-           (result==0) ? "SKIP" : (result==1) ? "SAVE" : "FAIL",
-           save_cnt, skip_cnt, fail_cnt);
+    if( self->qw_result == -1 )
+    {
+      queue->qc_journal_ok = 0;
+      queue_snap_ok    = 0;
+      err              = -1;
+    }
+
+    queue_save_account(self->qw_result);
+    queue_write_delete(self);
+  }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * release buffers
+   * check deferred while writes were
+   * still in progress
    * - - - - - - - - - - - - - - - - - - - */
 
-  free(old_data);
-  free(new_data);
+  if( queue_watch_pending && queue_writer_jobs == 0 )
+  {
+    queue_check_external();
+  }
 
+  return err;
 }
 
 /* ------------------------------------------------------------------------- *
@@ -1341,6 +4997,8 @@ void
 queue_save_forced(void)
 {
   queue_save_internal(1);
+  queue_writer_wait();
+  queue_save_finish();
 }
 
 /* ------------------------------------------------------------------------- *
@@ -1362,21 +5020,59 @@ queue_load(void)
   // the actual queue file was loaded
   int first = 0;
 
+  // snapshot generation
+  unsigned gen = 0;
+
   /* - - - - - - - - - - - - - - - - - - - *
-   * try loading the queue file from the
-   * list of candidates
+   * use binary snapshot if it is in sync
+   * with the queue file
    * - - - - - - - - - - - - - - - - - - - */
 
-  for( int i = 0; order[i] != 0; ++i )
+  if( queue_bin_load(&gen) != -1 )
+  {
+    queue_journal_replay(&queue_main, gen);
+    first = 1;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * otherwise try loading the queue file
+   * from the list of candidates
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( int i = 0; !first && order[i] != 0; ++i )
   {
     if( access(order[i], F_OK) == 0 )
     {
-      queue_load_from_path(order[i]);
+      queue_load_from_path(&queue_main, order[i], &gen);
       first = (i == 0);
+
+      /* - - - - - - - - - - - - - - - - - - - *
+       * the journal is valid only on top of
+       * the snapshot it was started for
+       * - - - - - - - - - - - - - - - - - - - */
+
+      if( first )
+      {
+        queue_bin_save(gen);
+        queue_journal_replay(&queue_main, gen);
+      }
+      else
+      {
+        queue->qc_journal_gen = gen;
+        queue->qc_journal_ok  = 0;
+      }
       break;
     }
   }
 
+  /* - - - - - - - - - - - - - - - - - - - *
+   * set up initial states; whatever was
+   * loaded is already in persistent storage
+   * - - - - - - - - - - - - - - - - - - - */
+
+  queue_load_normalize();
+  queue_journal_forget();
+
   /* - - - - - - - - - - - - - - - - - - - *
    * update "current content" stats
    * - - - - - - - - - - - - - - - - - - - */
@@ -1394,6 +5090,95 @@ queue_load(void)
   }
 }
 
+/* ========================================================================= *
+ * QUEUE FILE WATCH
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * queue_watch_start  --  start watching the cache directory
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_watch_start(void)
+{
+  if( queue_watch_fd != -1 )
+  {
+    return;
+  }
+
+  if( (queue_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1 )
+  {
+    log_warning("inotify: %s\n", strerror(errno));
+  }
+  else if( inotify_add_watch(queue_watch_fd, ALARMD_CONFIG_CACHEDIR,
+                             IN_CLOSE_WRITE | IN_MOVED_TO) == -1 )
+  {
+    log_warning("%s: inotify watch: %s\n", ALARMD_CONFIG_CACHEDIR,
+                strerror(errno));
+    close(queue_watch_fd), queue_watch_fd = -1;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_watch_stop
+ * ------------------------------------------------------------------------- */
+
+static
+void
+queue_watch_stop(void)
+{
+  if( queue_watch_fd != -1 )
+  {
+    close(queue_watch_fd), queue_watch_fd = -1;
+  }
+  queue_watch_pending = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_get_watch_fd  --  descriptor to poll for queue file changes
+ * ------------------------------------------------------------------------- */
+
+int
+queue_get_watch_fd(void)
+{
+  return queue_watch_fd;
+}
+
+/* ------------------------------------------------------------------------- *
+ * queue_handle_watch  --  process pending cache directory changes
+ * ------------------------------------------------------------------------- */
+
+void
+queue_handle_watch(void)
+{
+  const char *name = strrchr(QUEUE_DATABASE, '/') + 1;
+  int         hit  = 0;
+  char        buff[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t     size;
+
+  while( (size = read(queue_watch_fd, buff, sizeof buff)) > 0 )
+  {
+    for( ssize_t pos = 0; pos < size; )
+    {
+      const struct inotify_event *ev = (const void *)(buff + pos);
+
+      if( (ev->mask & IN_Q_OVERFLOW) ||
+          (ev->len != 0 && !strcmp(ev->name, name)) )
+      {
+        hit = 1;
+      }
+      pos += sizeof *ev + ev->len;
+    }
+  }
+
+  if( hit )
+  {
+    queue_save_finish();
+    queue_check_external();
+  }
+}
+
 /* ========================================================================= *
  * DIRTY STATE CONTROL
  * ========================================================================= */
@@ -1440,6 +5225,10 @@ int
 queue_init(void)
 {
   queue_load();
+  queue_writer_start();
+#if ALARMD_QUEUE_MODIFIED_MERGE
+  queue_watch_start();
+#endif
   return 0;
 }
 
@@ -1450,6 +5239,9 @@ queue_init(void)
 void
 queue_quit(void)
 {
+  queue_watch_stop();
   queue_save();
-  queue_flush_events();
+  queue_writer_stop();
+  queue_save_finish();
+  queue_flush_events(&queue_main);
 }
@@ -33,27 +33,78 @@ extern "C" {
 } /* fool JED indentation ... */
 #endif
 
+/* ========================================================================= *
+ * types
+ * ========================================================================= */
+
+/** Iterator for walking through events in one state
+ *
+ * Events may change state while being iterated; each event that
+ * was in the state when the iteration started is visited once.
+ */
+typedef struct queue_iter_t
+{
+  unsigned qi_state;
+  unsigned qi_stamp;
+} queue_iter_t;
+
+/** Iterate over enabled events in state STATE
+ *
+ * Usage: queue_foreach_in_state(iter, ALARM_STATE_NEW, eve) { ... }
+ */
+#define queue_foreach_in_state(ITER, STATE, EVE)\
+  for( EVE = queue_iter_first(&(ITER), (STATE)); EVE;\
+       EVE = queue_iter_next(&(ITER)) )
+
+/** Queue size and persistence statistics, see queue_get_stats() */
+typedef struct queue_stats_t
+{
+  unsigned qs_events;    // events in queue
+  unsigned qs_bytes;     // size of queue file + journal
+  unsigned qs_saved;     // full snapshot writes
+  unsigned qs_journaled; // journal appends
+  unsigned qs_skipped;   // saves with nothing to write
+  unsigned qs_failed;    // failed saves
+} queue_stats_t;
+
 /* ========================================================================= *
  * extern functions
  * ========================================================================= */
 
 void           queue_set_modified_cb  (void (*cb)(void));
+void           queue_set_saved_cb     (void (*cb)(void));
 unsigned       queue_get_snooze       (void);
 void           queue_set_snooze       (unsigned snooze);
 void           queue_event_set_trigger(alarm_event_t *event, time_t trigger);
 unsigned       queue_event_get_state  (const alarm_event_t *self);
 void           queue_event_set_state  (alarm_event_t *self, unsigned state);
+void           queue_event_changed    (alarm_event_t *self);
+void           queue_event_unpack     (alarm_event_t *self);
 cookie_t       queue_add_event        (alarm_event_t *event);
 alarm_event_t *queue_get_event        (cookie_t cookie);
 int            queue_del_event        (cookie_t cookie);
 cookie_t      *queue_query_events     (int *pcnt, time_t lo, time_t hi, unsigned mask, unsigned flag, const char *app);
 cookie_t      *queue_query_by_state   (int *pcnt, unsigned state);
+alarm_event_t *queue_iter_first       (queue_iter_t *iter, unsigned state);
+alarm_event_t *queue_iter_next        (queue_iter_t *iter);
+unsigned       queue_get_visited      (void);
+size_t         queue_touched_count    (void);
+alarm_event_t *queue_touched_get      (size_t index, unsigned *pstate);
+void           queue_touched_clear    (void);
+cookie_t      *queue_take_replaced    (int *pcnt);
 int            queue_count_by_state_and_flag   (unsigned state, unsigned flag);
 int            queue_count_by_state   (unsigned state);
+int            queue_count_by_flag    (unsigned flag);
+const char    *queue_get_state_name   (unsigned state);
+const char    *queue_get_app          (size_t index, int *pcnt);
+void           queue_get_stats        (queue_stats_t *stats);
 void           queue_cleanup_deleted  (void);
 void           queue_save             (void);
 void           queue_load             (void);
 void           queue_save_forced      (void);
+int            queue_save_finish      (void);
+int            queue_get_watch_fd     (void);
+void           queue_handle_watch     (void);
 void           queue_set_dirty        (void);
 void           queue_clr_dirty        (void);
 int            queue_is_dirty         (void);
@@ -27,6 +27,7 @@
 #include "libalarm.h"
 #include "ticker.h"
 #include "logging.h"
+#include "pool.h"
 
 #include <stdlib.h>
 
@@ -65,7 +66,7 @@ alarm_recur_dtor(alarm_recur_t *self)
 alarm_recur_t *
 alarm_recur_create(void)
 {
-  alarm_recur_t *self = calloc(1, sizeof *self);
+  alarm_recur_t *self = pool_alloc(&pool_recur[0]);
   alarm_recur_ctor(self);
   return self;
 }
@@ -80,7 +81,7 @@ alarm_recur_delete(alarm_recur_t *self)
   if( self != 0 )
   {
     alarm_recur_dtor(self);
-    free(self);
+    pool_release(&pool_recur[0], self);
   }
 }
 
@@ -110,68 +111,141 @@ alarm_recur_delete_cb(void *self)
 }
 
 /* ------------------------------------------------------------------------- *
- * alarm_recur_handle_masks
+ * alarm_recur_civil_days  --  days since 1970-01-01, proleptic gregorian
  * ------------------------------------------------------------------------- */
 
 static
-time_t
-alarm_recur_handle_masks(const alarm_recur_t *self, struct tm *dst,
-                         const char *tz, int align_only)
+int64_t
+alarm_recur_civil_days(int64_t y, int m, int d)
+{
+  /* March based year puts the leap day at the end */
+  y -= (m < 2);
+  m += (m < 2) ? 10 : -2;
+
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * m + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + doe - 719468;
+}
+
+/* ------------------------------------------------------------------------- *
+ * alarm_recur_floor_div  --  division rounding towards minus infinity
+ * ------------------------------------------------------------------------- */
+
+static inline
+int64_t
+alarm_recur_floor_div(int64_t a, int64_t b)
+{
+  return (a >= 0) ? (a / b) : -((b - 1 - a) / b);
+}
+
+/* ------------------------------------------------------------------------- *
+ * alarm_recur_normalize  --  calendar normalization without time zones
+ * ------------------------------------------------------------------------- */
+
+/* Carries minutes -> hours -> days and months -> years like mktime()
+ * does, but ignores daylight saving time. Updates tm_wday. */
+
+static
+void
+alarm_recur_normalize(struct tm *tm)
 {
-  time_t    res = -1;
-  int       inc = (align_only == 0);
+  int64_t v, c, days;
+
+  v = tm->tm_min;
+  c = alarm_recur_floor_div(v, 60);
+  tm->tm_min = v - c * 60;
+
+  v = tm->tm_hour + c;
+  c = alarm_recur_floor_div(v, 24);
+  tm->tm_hour = v - c * 24;
+
+  v = tm->tm_mon;
+  int64_t y = tm->tm_year + 1900 + alarm_recur_floor_div(v, 12);
+  int     m = v - alarm_recur_floor_div(v, 12) * 12;
+
+  days = alarm_recur_civil_days(y, m, 1) + tm->tm_mday - 1 + c;
+
+  /* back from day number to year, month and day */
+  int64_t z   = days + 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int64_t doe = z - era * 146097;
+  int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+  int64_t mp  = (5 * doy + 2) / 153;
+
+  tm->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+  tm->tm_mon  = (mp < 10) ? mp + 2 : mp - 10;
+  tm->tm_year = yoe + era * 400 + (tm->tm_mon < 2) - 1900;
+  tm->tm_wday = days + 4 - 7 * alarm_recur_floor_div(days + 4, 7);
+}
 
-  /* Hours, minutes and seconds behave logically and
-   * can thus be handled separately */
+/* ------------------------------------------------------------------------- *
+ * alarm_recur_solve_masks  --  next allowed time on the broken down time
+ * ------------------------------------------------------------------------- */
+
+/* Finds the next allowed minute, hour, month and day with bit scans
+ * on the broken down time instead of stepping and calling mktime()
+ * for every step. Time zones and daylight saving time are ignored.
+ *
+ * Returns 1 if tm was adjusted, 0 if there is nothing to do and
+ * -1 if the masks do not match any date. */
+
+/* months to scan before giving up on masks that never match,
+ * the gregorian calendar repeats itself every 400 years */
+#define RECUR_SOLVE_MAX_MONTHS (400 * 12)
+
+static
+int
+alarm_recur_solve_masks(const alarm_recur_t *self, struct tm *tm,
+                        int align_only)
+{
+  int      inc  = (align_only == 0);
+  int      done = 0;
+  uint64_t mins = self->mask_min  & ALARM_RECUR_MIN_ALL;
+  uint32_t hrs  = self->mask_hour & ALARM_RECUR_HOUR_ALL;
 
   // SECONDS
-  if( dst->tm_sec != 0 )
+  if( tm->tm_sec != 0 )
   {
-    inc = 0, dst->tm_min += 1, dst->tm_sec = 0;
-    if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
-    {
-      goto cleanup;
-    }
-    //log_debug("SECS: %s\n", ticker_date_format_long(0,0,res));
+    inc = 0, tm->tm_min += 1, tm->tm_sec = 0, done = 1;
   }
+  alarm_recur_normalize(tm);
 
   // MINUTES
-  if( self->mask_min & ALARM_RECUR_MIN_ALL )
+  if( mins != 0 )
   {
-    for( dst->tm_min += inc, inc = 0; ; dst->tm_min += 1 )
+    tm->tm_min += inc, inc = 0, done = 1;
+    alarm_recur_normalize(tm);
+
+    uint64_t later = mins & (~0ull << tm->tm_min);
+
+    if( later == 0 )
     {
-      if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
-      {
-        goto cleanup;
-      }
-      if( (self->mask_min & (1llu<<dst->tm_min)) )
-      {
-        break;
-      }
+      tm->tm_hour += 1, later = mins;
     }
-    //log_debug("MINS: %s\n", ticker_date_format_long(0,0,res));
+    tm->tm_min = __builtin_ctzll(later);
+    alarm_recur_normalize(tm);
   }
 
   // HOURS
-  if( self->mask_hour & ALARM_RECUR_HOUR_ALL )
+  if( hrs != 0 )
   {
-    for( dst->tm_hour += inc, inc = 0; ; dst->tm_hour += 1 )
+    tm->tm_hour += inc, inc = 0, done = 1;
+    alarm_recur_normalize(tm);
+
+    uint32_t later = hrs & (~0u << tm->tm_hour);
+
+    if( later == 0 )
     {
-      if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
-      {
-        goto cleanup;
-      }
-      if( (self->mask_hour & (1u<<dst->tm_hour)) )
-      {
-        break;
-      }
+      tm->tm_mday += 1, later = hrs;
     }
-    //log_debug("HOUR: %s\n", ticker_date_format_long(0,0,res));
+    tm->tm_hour = __builtin_ctz(later);
+    alarm_recur_normalize(tm);
   }
 
-  /* Month, day of month and day of week do not progress
-   * linearly and thus must be handled all at once */
-
   // DAY OF MONTH and DAY OF WEEK and MONTH
 
   uint32_t M_wday = self->mask_wday & ALARM_RECUR_WDAY_ALL;
@@ -179,53 +253,224 @@ alarm_recur_handle_masks(const alarm_recur_t *self, struct tm *dst,
   uint32_t M_eom  = self->mask_mday & ALARM_RECUR_MDAY_EOM;
   uint32_t M_mon  = self->mask_mon  & ALARM_RECUR_MON_ALL;
 
-  if( M_wday || M_mday || M_eom || M_mon )
+  if( !(M_wday || M_mday || M_eom || M_mon) )
   {
-    if( M_wday == 0 )
+    return done;
+  }
+
+  if( M_wday == 0 )
+  {
+    M_wday = ALARM_RECUR_WDAY_ALL;
+  }
+  if( M_mday == 0 && M_eom == 0 )
+  {
+    M_mday = ALARM_RECUR_MDAY_ALL;
+  }
+  if( M_mon == 0 )
+  {
+    M_mon = ALARM_RECUR_MON_ALL;
+  }
+
+  tm->tm_mday += inc;
+  alarm_recur_normalize(tm);
+
+  for( int n = 0; n < RECUR_SOLVE_MAX_MONTHS; ++n )
+  {
+    if( !(M_mon & (1u << tm->tm_mon)) )
     {
-      M_wday = ALARM_RECUR_WDAY_ALL;
+      uint32_t later = M_mon & (~0u << tm->tm_mon);
+
+      if( later == 0 )
+      {
+        tm->tm_year += 1, later = M_mon;
+      }
+      tm->tm_mon  = __builtin_ctz(later);
+      tm->tm_mday = 1;
+      alarm_recur_normalize(tm);
     }
-    if( M_mday == 0 && M_eom == 0 )
+
+    int      dim    = ticker_get_days_in_month(tm);
+    uint32_t T_mday = M_mday;
+
+    if( M_eom )
     {
-      M_mday = ALARM_RECUR_MDAY_ALL;
+      T_mday |= (1u << dim);
     }
-    if( M_mon == 0 )
+
+    /* allowed days from current day to end of month */
+    T_mday &= (~0u << tm->tm_mday);
+    T_mday &= (dim < 31) ? ((2u << dim) - 1) : ~0u;
+
+    for( ; T_mday != 0; T_mday &= T_mday - 1 )
     {
-      M_mon = ALARM_RECUR_MON_ALL;
+      int mday = __builtin_ctz(T_mday);
+      int wday = (tm->tm_wday + mday - tm->tm_mday) % 7;
+
+      if( M_wday & (1u << wday) )
+      {
+        tm->tm_mday = mday;
+        alarm_recur_normalize(tm);
+        return 1;
+      }
     }
 
-    for( dst->tm_mday += inc, inc = 0;; )
+    tm->tm_mon += 1, tm->tm_mday = 1;
+    alarm_recur_normalize(tm);
+  }
+
+  return -1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * alarm_recur_compare_time  --  compare local date and time of day
+ * ------------------------------------------------------------------------- */
+
+static
+int
+alarm_recur_compare_time(const struct tm *a, const struct tm *b)
+{
+  if( a->tm_year != b->tm_year ) return (a->tm_year < b->tm_year) ? -1 : 1;
+  if( a->tm_mon  != b->tm_mon  ) return (a->tm_mon  < b->tm_mon)  ? -1 : 1;
+  if( a->tm_mday != b->tm_mday ) return (a->tm_mday < b->tm_mday) ? -1 : 1;
+  if( a->tm_hour != b->tm_hour ) return (a->tm_hour < b->tm_hour) ? -1 : 1;
+  if( a->tm_min  != b->tm_min  ) return (a->tm_min  < b->tm_min)  ? -1 : 1;
+  if( a->tm_sec  != b->tm_sec  ) return (a->tm_sec  < b->tm_sec)  ? -1 : 1;
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * alarm_recur_handle_masks
+ * ------------------------------------------------------------------------- */
+
+/* The masks apply to the local wall clock time. The next allowed
+ * time is solved on the broken down time without regard to daylight
+ * saving time, and only the result is converted with mktime():
+ *
+ * - A result that does not exist, because the clocks are turned
+ *   forward over it, is moved forward by the length of the gap like
+ *   mktime() does, and the masks are solved again from there.
+ *
+ * - A result that exists twice, because the clocks are turned back
+ *   over it, resolves to the earlier occurrence if that is after the
+ *   start and to the later one otherwise. The same wall clock time
+ *   is not matched twice.
+ *
+ * The start is converted as given, so tm_isdst of dst selects the
+ * occurrence of an ambiguous start time.
+ *
+ * Returns the resolved time and updates dst, or -1 if there are no
+ * masks to align to or they do not match any date. */
+
+/* how many times to solve again after hitting a local time
+ * that does not exist before giving up */
+#define RECUR_RESOLVE_MAX_TRIES 8
+
+static
+time_t
+alarm_recur_handle_masks(const alarm_recur_t *self, struct tm *dst,
+                         const char *tz, int align_only)
+{
+  struct tm cal = *dst;
+
+  switch( alarm_recur_solve_masks(self, &cal, align_only) )
+  {
+  case 0:
+    /* nothing to align to */
+    return -1;
+
+  case -1:
+    goto nomatch;
+  }
+
+  for( int tries = 0; ; )
+  {
+    struct tm nxt = cal;
+    struct tm hit[2];
+    time_t    when[2];
+    int       cnt = 0;
+
+    nxt.tm_min += 1;
+    alarm_recur_normalize(&nxt);
+
+    /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - *
+     * Convert both with and without daylight saving time. A time
+     * that round trips both ways to different times is ambiguous.
+     * One that does not round trip either way does not exist, and
+     * the later one of the times mktime() moved it to is past the
+     * gap.
+     * - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+    for( int isdst = 1; isdst >= 0; --isdst )
     {
-      if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
+      struct tm res = cal;
+      time_t    t;
+
+      res.tm_isdst = isdst;
+
+      if( (t = ticker_build_tm(&res, tz)) == -1 )
       {
-        goto cleanup;
+        return -1;
       }
 
-      if( !(M_mon & (1u << dst->tm_mon)) )
+      int cmp = alarm_recur_compare_time(&res, &cal);
+
+      if( cmp == 0 )
+      {
+        hit[cnt] = res, when[cnt] = t, cnt += 1;
+      }
+      else if( cmp > 0 && alarm_recur_compare_time(&res, &nxt) > 0 )
       {
-        inc = 0, dst->tm_mon += 1, dst->tm_mday = 1;
-        continue;
+        nxt = res;
       }
+    }
+
+    if( cnt == 2 && when[0] != when[1] )
+    {
+      /* The solver does not go backwards in local time, so the
+       * later occurrence is always after the start. Converting
+       * the start is needed only to check the earlier one. */
 
-      uint32_t T_mday = M_mday;
+      struct tm beg = *dst;
+      time_t    t0;
+      int       i   = (when[1] < when[0]);
 
-      if( M_eom )
+      if( (t0 = ticker_build_tm(&beg, tz)) == -1 )
       {
-        T_mday |= (1u << ticker_get_days_in_month(dst));
+        return -1;
       }
-
-      if( (M_wday & (1<<dst->tm_wday)) && (T_mday & (1<<dst->tm_mday)) )
+      if( when[i] < t0 || (when[i] == t0 && !align_only) )
       {
-        break;
+        i = !i;
       }
-      inc = 0, dst->tm_mday += 1;
+
+      *dst = hit[i];
+      return when[i];
+    }
+
+    if( cnt != 0 )
+    {
+      *dst = hit[0];
+      return when[0];
+    }
+
+    if( ++tries > RECUR_RESOLVE_MAX_TRIES )
+    {
+      log_warning("recurrence masks do not resolve to local time\n");
+      return -1;
+    }
+
+    /* solve again from past the gap */
+    cal = nxt;
+    if( alarm_recur_solve_masks(self, &cal, 1) == -1 )
+    {
+      goto nomatch;
     }
-    //log_debug("DATE: %s\n", ticker_date_format_long(0,0,res));
   }
 
-  cleanup:
+  nomatch:
 
-  return res;
+  log_warning("recurrence masks do not match any date\n");
+  return -1;
 }
 
 /* ------------------------------------------------------------------------- *
@@ -29,6 +29,7 @@
 #include "queue.h"
 #include "ticker.h"
 #include "dbusif.h"
+#include "codec.h"
 #include "xutil.h"
 #include "hwrtc.h"
 #include "serialize.h"
@@ -69,6 +70,8 @@ static gboolean            server_queue_idle_cb                 (gpointer data);
 static void                server_queue_cancel_save             (void);
 static void                server_queue_request_save            (void);
 static void                server_queue_forced_save             (void);
+static gboolean            server_queue_saved_cb                (gpointer data);
+static void                server_queue_saved_wakeup            (void);
 
 static unsigned            server_state_get                     (void);
 static void                server_state_clr                     (unsigned clr);
@@ -124,6 +127,7 @@ static int                 server_handle_systemui_rsp           (cookie_t cookie
 
 static void                server_rethink_new                   (void);
 static void                server_rethink_waitconn              (void);
+static void                server_rethink_queued_event          (alarm_event_t *eve, time_t now);
 static void                server_rethink_queued                (void);
 static void                server_rethink_missed                (void);
 static void                server_rethink_postponed             (void);
@@ -147,11 +151,16 @@ static DBusMessage        *server_handle_set_debug              (DBusMessage *ms
 static DBusMessage        *server_handle_CUD                    (DBusMessage *msg);
 static DBusMessage        *server_handle_RFS                    (DBusMessage *msg);
 static DBusMessage        *server_handle_snooze_get             (DBusMessage *msg);
+static DBusMessage        *server_handle_queue_stats            (DBusMessage *msg);
 static DBusMessage        *server_handle_snooze_set             (DBusMessage *msg);
 static DBusMessage        *server_handle_event_add              (DBusMessage *msg);
 static DBusMessage        *server_handle_event_update           (DBusMessage *msg);
 static DBusMessage        *server_handle_event_del              (DBusMessage *msg);
+static DBusMessage        *server_handle_events_add             (DBusMessage *msg);
+static DBusMessage        *server_handle_events_update          (DBusMessage *msg);
+static DBusMessage        *server_handle_events_del             (DBusMessage *msg);
 static DBusMessage        *server_handle_event_query            (DBusMessage *msg);
+static DBusMessage        *server_handle_event_query_full       (DBusMessage *msg);
 static DBusMessage        *server_handle_event_get              (DBusMessage *msg);
 static DBusMessage        *server_handle_event_ack              (DBusMessage *msg);
 static DBusMessage        *server_handle_queue_ack              (DBusMessage *msg);
@@ -532,6 +541,33 @@ server_queue_forced_save(void)
   server_queue_save_cb(0);
 }
 
+/* ------------------------------------------------------------------------- *
+ * server_queue_saved_cb  --  handle writes finished in the background
+ * ------------------------------------------------------------------------- */
+
+static
+gboolean
+server_queue_saved_cb(gpointer data)
+{
+  if( queue_save_finish() == -1 )
+  {
+    // the next save will rewrite the whole snapshot
+    server_queue_request_save();
+  }
+  return FALSE;
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_queue_saved_wakeup  --  called from the queue writer thread
+ * ------------------------------------------------------------------------- */
+
+static
+void
+server_queue_saved_wakeup(void)
+{
+  g_idle_add(server_queue_saved_cb, 0);
+}
+
 /* ========================================================================= *
  * Server State
  * ========================================================================= */
@@ -1200,6 +1236,7 @@ server_action_do_disable(alarm_event_t *event, alarm_action_t *action)
    */
   log_info("DISABLING DUE TO ACTION: cookie=%d\n", (int)event->ALARMD_PRIVATE(cookie));
   event->flags |= ALARM_EVENT_DISABLED;
+  queue_event_changed(event);
   return 0;
 }
 
@@ -1431,6 +1468,10 @@ server_event_do_state_actions(alarm_event_t *eve, unsigned when)
       alarm_action_t *act = &eve->action_tab[i];
       if( server_action_get_when(act) & when )
       {
+        // action strings of events loaded from binary
+        // snapshot are decoded on demand; the action
+        // table can move in the process
+        queue_event_unpack(eve), act = &eve->action_tab[i];
         server_action_do_all(eve, act);
       }
     }
@@ -1451,6 +1492,7 @@ server_event_do_response_actions(alarm_event_t *eve)
 
     if( server_action_get_when(act) & ALARM_ACTION_WHEN_RESPONDED )
     {
+      queue_event_unpack(eve), act = &eve->action_tab[eve->response];
       server_action_do_all(eve, act);
     }
   }
@@ -1901,6 +1943,8 @@ static guint  server_rethink_id  = 0;
 
 static time_t server_rethink_time = 0;
 
+static unsigned server_rethink_cnt = 0; // rethink passes done
+
 /* ------------------------------------------------------------------------- *
  * time_filt  --  utility for scanning lowest time_t value
  * ------------------------------------------------------------------------- */
@@ -1979,22 +2023,18 @@ static
 void
 server_rethink_new(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = 0;
-
-  vec = queue_query_by_state(&cnt, ALARM_STATE_NEW);
+  queue_iter_t   iter;
+  alarm_event_t *eve;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_NEW, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
 #if ENABLE_LOGGING >= 3
     {
       time_t now = server_rethink_time;
       time_t trg = alarm_event_get_trigger(eve);
 
       log_info("[%ld] NEW: %s (T%s)\n",
-               (long)vec[i],
+               (long)alarm_event_get_cookie(eve),
                ticker_date_format_long(0,0,trg),
                ticker_secs_format(0,0,now-trg));
 
@@ -2026,8 +2066,6 @@ server_rethink_new(void)
     queue_event_set_state(eve, ALARM_STATE_QUEUED);
     server_event_do_state_actions(eve, ALARM_ACTION_WHEN_QUEUED);
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2040,45 +2078,33 @@ server_rethink_waitconn(void)
 {
   if( server_state_get() & SF_CONNECTED )
   {
-    int       cnt = 0;
-    cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_WAITCONN);
+    queue_iter_t   iter;
+    alarm_event_t *eve;
 
-    for( int i = 0; i < cnt; ++i )
+    queue_foreach_in_state(iter, ALARM_STATE_WAITCONN, eve)
     {
-      alarm_event_t *eve = queue_get_event(vec[i]);
       queue_event_set_state(eve, ALARM_STATE_NEW);
     }
-    free(vec);
   }
 }
 
 /* ------------------------------------------------------------------------- *
- * server_rethink_queued
+ * server_rethink_queued_event  --  evaluate one event in queued state
  * ------------------------------------------------------------------------- */
 
 static
 void
-server_rethink_queued(void)
+server_rethink_queued_event(alarm_event_t *eve, time_t now)
 {
-  time_t    now = server_rethink_time;
-  time_t    tsw = INT_MAX;
-  time_t    thw = INT_MAX;
-  int       cnt = 0;
-  cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_QUEUED);
-
-  for( int i = 0; i < cnt; ++i )
+  // required internet connection not available?
+  if( eve->flags & ALARM_EVENT_CONNECTED )
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
-    // required internet connection not available?
-    if( eve->flags & ALARM_EVENT_CONNECTED )
+    if( !(server_state_get() & SF_CONNECTED) )
     {
-      if( !(server_state_get() & SF_CONNECTED) )
-      {
-        queue_event_set_state(eve, ALARM_STATE_WAITCONN);
-        continue;
-      }
+      queue_event_set_state(eve, ALARM_STATE_WAITCONN);
+      return;
     }
+  }
 
 // QUARANTINE     {
 // QUARANTINE       const char *tz = server_event_get_tz(eve);
@@ -2089,42 +2115,138 @@ server_rethink_queued(void)
 // QUARANTINE       log_debug("Q: %s, at %+d\n", trg, (int)(alarm_event_get_trigger(eve) - now));
 // QUARANTINE     }
 
-    // in future -> just update wakeup time values
-    if( alarm_event_get_trigger(eve) > now )
+  // in future -> just update wakeup time values
+  if( alarm_event_get_trigger(eve) > now )
+  {
+    unsigned boot = server_event_get_boot_mask(eve);
+
+    if( boot & ALARM_EVENT_BOOT )
+    {
+      time_filt(&server_queuestate_curr.qs_desktop, alarm_event_get_trigger(eve));
+    }
+    else if( boot & ALARM_EVENT_ACTDEAD )
+    {
+      time_filt(&server_queuestate_curr.qs_actdead, alarm_event_get_trigger(eve));
+    }
+    else
     {
-      unsigned boot = server_event_get_boot_mask(eve);
+      time_filt(&server_queuestate_curr.qs_no_boot, alarm_event_get_trigger(eve));
+    }
 
-      if( boot & ALARM_EVENT_BOOT )
-      {
-        time_filt(&server_queuestate_curr.qs_desktop, alarm_event_get_trigger(eve));
-      }
-      else if( boot & ALARM_EVENT_ACTDEAD )
-      {
-        time_filt(&server_queuestate_curr.qs_actdead, alarm_event_get_trigger(eve));
-      }
-      else
+    if( eve->flags & ALARM_EVENT_SHOW_ICON )
+    {
+      server_icons_curr += 1;
+    }
+    return;
+  }
+
+  // missed for some reason, power off for example
+  if( (now - alarm_event_get_trigger(eve)) > SERVER_MISSED_LIMIT )
+  {
+    queue_event_set_state(eve, ALARM_STATE_MISSED);
+    return;
+  }
+
+  // trigger it
+  queue_event_set_state(eve, ALARM_STATE_LIMBO);
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_rethink_queued
+ * ------------------------------------------------------------------------- */
+
+/* wakeup values and icon count for queued events, as evaluated
+ * at the end of the previous pass through server_rethink_queued() */
+static int                 server_queued_valid = 0;
+static unsigned            server_queued_state = 0;
+static server_queuestate_t server_queued_cache;
+static int                 server_queued_icons = 0;
+
+static
+void
+server_rethink_queued(void)
+{
+  time_t         now  = server_rethink_time;
+  time_t         tsw  = INT_MAX;
+  time_t         thw  = INT_MAX;
+  unsigned       conn = server_state_get() & SF_CONNECTED;
+  int            full = !server_queued_valid;
+  size_t         cnt  = queue_touched_count();
+  queue_iter_t   iter;
+  alarm_event_t *eve;
+  unsigned       was;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * values from the previous evaluation
+   * stay valid unless events have left
+   * the queued state, had trigger time
+   * changed while queued or have become
+   * due since then
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( conn != server_queued_state ||
+      server_queued_cache.qs_desktop <= now ||
+      server_queued_cache.qs_actdead <= now ||
+      server_queued_cache.qs_no_boot <= now )
+  {
+    full = 1;
+  }
+
+  if( !full )
+  {
+    // start from previous values, then
+    // evaluate only the touched events
+    server_queuestate_curr.qs_desktop = server_queued_cache.qs_desktop;
+    server_queuestate_curr.qs_actdead = server_queued_cache.qs_actdead;
+    server_queuestate_curr.qs_no_boot = server_queued_cache.qs_no_boot;
+    server_icons_curr                 = server_queued_icons;
+
+    for( size_t i = 0; i < cnt; ++i )
+    {
+      eve = queue_touched_get(i, &was);
+
+      if( was == ALARM_STATE_QUEUED )
       {
-        time_filt(&server_queuestate_curr.qs_no_boot, alarm_event_get_trigger(eve));
+        full = 1;
+        break;
       }
 
-      if( eve->flags & ALARM_EVENT_SHOW_ICON )
+      if( eve == 0 || (eve->flags & ALARM_EVENT_DISABLED) ||
+          queue_event_get_state(eve) != ALARM_STATE_QUEUED )
       {
-        server_icons_curr += 1;
+        continue;
       }
-      continue;
+
+      server_rethink_queued_event(eve, now);
     }
+  }
 
-    // missed for some reason, power off for example
-    if( (now - alarm_event_get_trigger(eve)) > SERVER_MISSED_LIMIT )
+  if( full )
+  {
+    // evaluate all events in queued state
+    server_queuestate_curr.qs_desktop = INT_MAX;
+    server_queuestate_curr.qs_actdead = INT_MAX;
+    server_queuestate_curr.qs_no_boot = INT_MAX;
+    server_icons_curr                 = 0;
+
+    queue_foreach_in_state(iter, ALARM_STATE_QUEUED, eve)
     {
-      queue_event_set_state(eve, ALARM_STATE_MISSED);
-      continue;
+      server_rethink_queued_event(eve, now);
     }
-
-    // trigger it
-    queue_event_set_state(eve, ALARM_STATE_LIMBO);
   }
 
+  /* - - - - - - - - - - - - - - - - - - - *
+   * remember the values for the next pass,
+   * changes made from here on are tracked
+   * via touched events again
+   * - - - - - - - - - - - - - - - - - - - */
+
+  server_queued_valid = 1;
+  server_queued_state = conn;
+  server_queued_cache = server_queuestate_curr;
+  server_queued_icons = server_icons_curr;
+  queue_touched_clear();
+
   // determinetimeout values
   time_filt(&thw, server_queuestate_curr.qs_desktop);
   time_filt(&thw, server_queuestate_curr.qs_actdead);
@@ -2150,9 +2272,6 @@ server_rethink_queued(void)
     gmtime_r(&trg, &tm);
     hwrtc_set_alarm(&tm, 1);
   }
-
-  // cleanup
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2163,16 +2282,12 @@ static
 void
 server_rethink_missed(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = 0;
-
-  vec = queue_query_by_state(&cnt, ALARM_STATE_MISSED);
+  queue_iter_t   iter;
+  alarm_event_t *eve;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_MISSED, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
-    log_debug("[%ld] MISSED\n", (long)vec[i]);
+    log_debug("[%ld] MISSED\n", (long)alarm_event_get_cookie(eve));
 
     /* - - - - - - - - - - - - - - - - - - - *
      * handle actions bound to missed alarms
@@ -2202,14 +2317,13 @@ server_rethink_missed(void)
       // once the ALARM_EVENT_DISABLED flag is set
       // -> no state transfer required
       eve->flags |= ALARM_EVENT_DISABLED;
+      queue_event_changed(eve);
       server_event_do_state_actions(eve, ALARM_ACTION_WHEN_DISABLED);
       continue;
     }
     //queue_event_set_state(eve, ALARM_STATE_DELETED);
     queue_event_set_state(eve, ALARM_STATE_SERVED);
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2220,16 +2334,14 @@ static
 void
 server_rethink_postponed(void)
 {
-  time_t    day = 24 * 60 * 60;
-  time_t    now = server_rethink_time;
-  int       cnt = 0;
-  cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_POSTPONED);
+  time_t         day = 24 * 60 * 60;
+  time_t         now = server_rethink_time;
+  queue_iter_t   iter;
+  alarm_event_t *eve;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_POSTPONED, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
-    log_debug("[%ld] POSTPONED\n", (long)vec[i]);
+    log_debug("[%ld] POSTPONED\n", (long)alarm_event_get_cookie(eve));
 
     time_t snooze = server_event_get_snooze(eve);
 
@@ -2256,8 +2368,6 @@ server_rethink_postponed(void)
     queue_event_set_trigger(eve, trg);
     queue_event_set_state(eve, ALARM_STATE_NEW);
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2268,8 +2378,8 @@ static
 void
 server_rethink_limbo(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = 0;
+  queue_iter_t   iter;
+  alarm_event_t *eve;
   unsigned current_server_state = 0;
   unsigned is_user_mode = 0;
 
@@ -2285,9 +2395,8 @@ server_rethink_limbo(void)
      * - - - - - - - - - - - - - - - - - - - */
 
     is_user_mode = !(current_server_state & SF_ACT_DEAD);
-    vec = queue_query_by_state(&cnt, ALARM_STATE_LIMBO);
 
-    for( int i = 0; i < cnt; ++i )
+    queue_foreach_in_state(iter, ALARM_STATE_LIMBO, eve)
     {
     /* - - - - - - - - - - - - - - - - - - - *
      * if we are in acting dead, only alarms
@@ -2296,15 +2405,12 @@ server_rethink_limbo(void)
      * Otherwise all alarms will be triggered
      * - - - - - - - - - - - - - - - - - - - */
 
-      alarm_event_t *eve = queue_get_event(vec[i]);
       if(is_user_mode  || eve->flags & ALARM_EVENT_ACTDEAD )
       {
         queue_event_set_state(eve, ALARM_STATE_TRIGGERED);
       }
     }
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2315,14 +2421,11 @@ static
 void
 server_rethink_triggered(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_TRIGGERED);
-  int       req = 0;
+  queue_iter_t   iter;
+  alarm_event_t *eve;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_TRIGGERED, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
     server_event_do_state_actions(eve, ALARM_ACTION_WHEN_TRIGGERED);
 
     {
@@ -2337,13 +2440,12 @@ server_rethink_triggered(void)
       ticker_break_tm(alarm_event_get_trigger(eve), &tm, tz);
       server_repr_tm(&tm, tz, trg, sizeof trg);
 
-      log_info("[%ld] TRIGGERED: %s -- %s\n", (long)vec[i], now, trg);
+      log_info("[%ld] TRIGGERED: %s -- %s\n", (long)alarm_event_get_cookie(eve), now, trg);
     }
 
     if( server_event_get_buttons(eve, 0,0) )
     {
       // transfer control to system ui
-      vec[req++] = eve->ALARMD_PRIVATE(cookie);
       queue_event_set_state(eve, ALARM_STATE_WAITSYSUI);
     }
     else if( queue_event_get_state(eve) == ALARM_STATE_SNOOZED )
@@ -2356,8 +2458,6 @@ server_rethink_triggered(void)
       queue_event_set_state(eve, ALARM_STATE_SERVED);
     }
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2401,15 +2501,13 @@ server_rethink_sysui_req(void)
 
   if( !server_state_get_systemui_service() )
   {
-    int       cnt = 0;
-    cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_SYSUI_REQ);
+    queue_iter_t   iter;
+    alarm_event_t *eve;
 
-    for( int i = 0; i < cnt; ++i )
+    queue_foreach_in_state(iter, ALARM_STATE_SYSUI_REQ, eve)
     {
-      alarm_event_t *eve = queue_get_event(vec[i]);
       queue_event_set_state(eve, ALARM_STATE_WAITSYSUI);
     }
-    free(vec);
   }
 }
 
@@ -2426,15 +2524,13 @@ server_rethink_sysui_ack(void)
 
   if( !server_state_get_systemui_service() )
   {
-    int       cnt = 0;
-    cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_SYSUI_ACK);
+    queue_iter_t   iter;
+    alarm_event_t *eve;
 
-    for( int i = 0; i < cnt; ++i )
+    queue_foreach_in_state(iter, ALARM_STATE_SYSUI_ACK, eve)
     {
-      alarm_event_t *eve = queue_get_event(vec[i]);
       queue_event_set_state(eve, ALARM_STATE_WAITSYSUI);
     }
-    free(vec);
   }
 }
 
@@ -2446,19 +2542,19 @@ static
 void
 server_rethink_sysui_rsp(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_SYSUI_RSP);
+  queue_iter_t   iter;
+  alarm_event_t *eve;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_SYSUI_RSP, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-    log_info("[%ld] RSP: button=%d\n", (long)vec[i], eve->response);
+    log_info("[%ld] RSP: button=%d\n", (long)alarm_event_get_cookie(eve), eve->response);
 
     if ( -1 == eve->response && 
          (eve->flags & ALARM_EVENT_DISABLE_DELAYED) &&
          !alarm_event_is_recurring(eve) )
     {
       eve->flags |= ALARM_EVENT_DISABLED;
+      queue_event_changed(eve);
       continue;
     }
 
@@ -2469,7 +2565,6 @@ server_rethink_sysui_rsp(void)
       queue_event_set_state(eve, ALARM_STATE_SERVED);
     }
   }
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2480,20 +2575,16 @@ static
 void
 server_rethink_snoozed(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = 0;
-  time_t    now = server_rethink_time;
+  queue_iter_t   iter;
+  alarm_event_t *eve;
+  time_t         now = server_rethink_time;
 
-  vec = queue_query_by_state(&cnt, ALARM_STATE_SNOOZED);
-
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_SNOOZED, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
     time_t snooze = server_event_get_snooze(eve);
     time_t curr   = now + snooze;
 
-    log_debug("[%ld] SNOOZED: secs=%ld\n", (long)vec[i], (long)snooze);
+    log_debug("[%ld] SNOOZED: secs=%ld\n", (long)alarm_event_get_cookie(eve), (long)snooze);
 
 #if SNOOZE_HIJACK_FIX
     if( eve->snooze_total == 0 )
@@ -2506,12 +2597,11 @@ server_rethink_snoozed(void)
     eve->snooze_total += add;
     log_debug("SNOOZE: %+d -> %+d\n", add, eve->snooze_total);
 #endif
+    queue_event_changed(eve);
 
     queue_event_set_trigger(eve, curr);
     queue_event_set_state(eve, ALARM_STATE_NEW);
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2522,14 +2612,12 @@ static
 void
 server_rethink_served(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_SERVED);
+  queue_iter_t   iter;
+  alarm_event_t *eve;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_SERVED, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
-
-    log_debug("[%ld] SERVED\n", (long)vec[i]);
+    log_debug("[%ld] SERVED\n", (long)alarm_event_get_cookie(eve));
 
     if( alarm_event_is_recurring(eve) )
     {
@@ -2538,8 +2626,6 @@ server_rethink_served(void)
     }
     queue_event_set_state(eve, ALARM_STATE_DELETED);
   }
-
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2550,19 +2636,18 @@ static
 void
 server_rethink_recurring(void)
 {
-  int       cnt = 0;
-  cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_RECURRING);
-  time_t    now = server_rethink_time;
+  queue_iter_t   iter;
+  alarm_event_t *eve;
+  time_t         now = server_rethink_time;
 
-  for( int i = 0; i < cnt; ++i )
+  queue_foreach_in_state(iter, ALARM_STATE_RECURRING, eve)
   {
-    alarm_event_t *eve = queue_get_event(vec[i]);
     const char *tz = server_event_get_tz(eve);
 
     time_t prev = alarm_event_get_trigger(eve);
     time_t curr = INT_MAX;
 
-    log_debug("[%ld] RECURRING: count=%d\n", (long)vec[i], eve->recur_count);
+    log_debug("[%ld] RECURRING: count=%d\n", (long)alarm_event_get_cookie(eve), eve->recur_count);
 
     if( eve->recur_count > 0 )
     {
@@ -2575,6 +2660,7 @@ server_rethink_recurring(void)
     prev -= eve->snooze_total;
     eve->snooze_total = 0;
 #endif
+    queue_event_changed(eve);
 
     if( eve->recur_count != 0 )
     {
@@ -2608,7 +2694,6 @@ server_rethink_recurring(void)
       queue_event_set_state(eve, ALARM_STATE_DELETED);
     }
   }
-  free(vec);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -2696,13 +2781,11 @@ server_rethink_timechange(void)
 
   if( zone || adj != 0 )
   {
-    int       cnt = 0;
-    cookie_t *vec = queue_query_by_state(&cnt, ALARM_STATE_QUEUED);
+    queue_iter_t   iter;
+    alarm_event_t *eve;
 
-    for( int i = 0; i < cnt; ++i )
+    queue_foreach_in_state(iter, ALARM_STATE_QUEUED, eve)
     {
-      alarm_event_t *eve = queue_get_event(vec[i]);
-
       /* - - - - - - - - - - - - - - - - - - - *
        * Snoozed alarms: Just adjust the trigger
        * time so that it still happens relative
@@ -2776,11 +2859,11 @@ server_rethink_timechange(void)
 
         ticker_break_tm(old, &tm, tz ?: server_tz_prev);
         server_repr_tm(&tm, tz ?: server_tz_prev, trg, sizeof trg);
-        log_debug("[%d] OLD: %s, at %+d\n", vec[i], trg, (int)(old - now));
+        log_debug("[%d] OLD: %s, at %+d\n", alarm_event_get_cookie(eve), trg, (int)(old - now));
 
         ticker_break_tm(use, &tm, tz ?: server_tz_curr);
         server_repr_tm(&tm, tz ?: server_tz_curr, trg, sizeof trg);
-        log_debug("[%d] NEW: %s, at %+d\n", vec[i], trg, (int)(use - now));
+        log_debug("[%d] NEW: %s, at %+d\n", alarm_event_get_cookie(eve), trg, (int)(use - now));
 
         queue_event_set_trigger(eve, use);
         queue_event_set_state(eve, ALARM_STATE_NEW);
@@ -2788,8 +2871,6 @@ server_rethink_timechange(void)
     }
 
     server_timestate_sync();
-
-    free(vec);
   }
 
   /* - - - - - - - - - - - - - - - - - - - *
@@ -2852,9 +2933,12 @@ server_rethink_start_cb(gpointer data)
 
   server_rethink_id   = 0;
   server_rethink_time = ticker_get_time();
+  server_rethink_cnt += 1;
 
   server_queue_cancel_save();
 
+  unsigned visited = queue_get_visited();
+
   log_info("-- rethink --\n");
   for( ;; )
   {
@@ -2898,6 +2982,9 @@ server_rethink_start_cb(gpointer data)
     if( !queue_is_dirty() ) break;
   }
 
+  log_info("-- rethink: %u events visited --\n",
+           queue_get_visited() - visited);
+
 // QUARANTINE   server_queuestate_curr.qs_alarms += queue_count_by_state(ALARM_STATE_LIMBO);
 // QUARANTINE   server_queuestate_curr.qs_alarms += queue_count_by_state(ALARM_STATE_TRIGGERED);
 // QUARANTINE   server_queuestate_curr.qs_alarms += queue_count_by_state(ALARM_STATE_SYSUI_RSP);
@@ -3092,6 +3179,111 @@ server_handle_snooze_get(DBusMessage *msg)
   return dbusif_reply_create(msg, DBUS_TYPE_UINT32, &val, DBUS_TYPE_INVALID);
 }
 
+/* ------------------------------------------------------------------------- *
+ * server_handle_queue_stats  --  handle ALARMD_QUEUE_STATS method call
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+server_handle_queue_stats(DBusMessage *msg)
+{
+  DBusMessage    *rsp = 0;
+  dbus_bool_t     ok  = TRUE;
+  queue_stats_t   qs;
+  DBusMessageIter iter;
+
+  auto void put_u32(dbus_uint32_t v);
+  auto void put_u32(dbus_uint32_t v)
+  {
+    ok = ok && dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT32, &v);
+  }
+  auto void put_i32(dbus_int32_t v);
+  auto void put_i32(dbus_int32_t v)
+  {
+    ok = ok && dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &v);
+  }
+  auto void put_str(const char *v);
+  auto void put_str(const char *v)
+  {
+    ok = ok && dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &v);
+  }
+
+  const char *name = 0;
+  unsigned    num  = 0;
+  int         cnt  = 0;
+
+  if( !(rsp = dbusif_reply_create(msg, DBUS_TYPE_INVALID)) )
+  {
+    goto cleanup;
+  }
+
+  queue_get_stats(&qs);
+
+  dbus_message_iter_init_append(rsp, &iter);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * queue size & nearest triggers
+   * - - - - - - - - - - - - - - - - - - - */
+
+  put_u32(qs.qs_events);
+  put_u32(qs.qs_bytes);
+
+  put_i32(server_queuestate_curr.qs_desktop);
+  put_i32(server_queuestate_curr.qs_actdead);
+  put_i32(server_queuestate_curr.qs_no_boot);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * activity counters
+   * - - - - - - - - - - - - - - - - - - - */
+
+  put_u32(server_rethink_cnt);
+  put_u32(qs.qs_saved);
+  put_u32(qs.qs_journaled);
+  put_u32(qs.qs_skipped);
+  put_u32(qs.qs_failed);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * enabled events by state & client flag
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( num = 0; queue_get_state_name(num); ++num ) {}
+
+  put_u32(num);
+  for( unsigned i = 0; i < num; ++i )
+  {
+    put_str(queue_get_state_name(i));
+    put_u32(queue_count_by_state(i));
+  }
+
+  put_u32(ALARM_EVENT_CLIENT_BITS);
+  for( unsigned i = 0; i < ALARM_EVENT_CLIENT_BITS; ++i )
+  {
+    put_u32(queue_count_by_flag(1u << i));
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * all events by application
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( num = 0; queue_get_app(num, &cnt); ++num ) {}
+
+  put_u32(num);
+  for( unsigned i = 0; (name = queue_get_app(i, &cnt)); ++i )
+  {
+    put_str(name);
+    put_u32(cnt);
+  }
+
+  if( !ok )
+  {
+    dbus_message_unref(rsp), rsp = 0;
+  }
+
+  cleanup:
+
+  return rsp;
+}
+
 /* ------------------------------------------------------------------------- *
  * server_handle_snooze_set  --  handle ALARMD_SNOOZE_SET method call
  * ------------------------------------------------------------------------- */
@@ -3117,100 +3309,118 @@ server_handle_snooze_set(DBusMessage *msg)
 }
 
 /* ------------------------------------------------------------------------- *
- * server_handle_event_add  --  handle ALARMD_EVENT_ADD method call
+ * server_queue_add_event  --  add event received from client to queue
  * ------------------------------------------------------------------------- */
 
 static
-DBusMessage *
-server_handle_event_add(DBusMessage *msg)
+cookie_t
+server_queue_add_event(alarm_event_t *event)
 {
-  DBusMessage   *rsp    = 0;
-  cookie_t       cookie = 0;
-  alarm_event_t *event  = 0;
+  cookie_t cookie = 0;
 
-  if( (event = dbusif_decode_event(msg)) != 0 )
-  {
-    /* - - - - - - - - - - - - - - - - - - - *
-     * client -> server: reset fields that
-     * are manged by the server
-     * - - - - - - - - - - - - - - - - - - - */
+  /* - - - - - - - - - - - - - - - - - - - *
+   * client -> server: reset fields that
+   * are manged by the server
+   * - - - - - - - - - - - - - - - - - - - */
 
-    event->response = -1;
-    event->snooze_total = 0;
+  event->response = -1;
+  event->snooze_total = 0;
 
-    alarm_event_set_cookie(event, 0);
-    alarm_event_set_trigger(event, 0);
-    queue_event_set_state(event, ALARM_STATE_NEW);
+  alarm_event_set_cookie(event, 0);
+  alarm_event_set_trigger(event, 0);
+  queue_event_set_state(event, ALARM_STATE_NEW);
 
-    time_t trigger = server_event_evaluate_initial_trigger(event);
+  time_t trigger = server_event_evaluate_initial_trigger(event);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the strings are borrowed from the D-Bus
+   * message, copy them only if the event
+   * is going to be queued
+   * - - - - - - - - - - - - - - - - - - - */
 
-    time_t now = ticker_get_time();
-    if( trigger >= now )
+  time_t now = ticker_get_time();
+  if( trigger >= now )
+  {
+    alarm_event_set_trigger(event, trigger);
+    decode_event_adopt(event);
+    if( (cookie = queue_add_event(event)) != 0 )
     {
-      alarm_event_set_trigger(event, trigger);
-      if( (cookie = queue_add_event(event)) != 0 )
-      {
-        event = 0;
-      }
+      event = 0;
     }
   }
+  else
+  {
+    decode_event_abandon(event);
+  }
 
   alarm_event_delete(event);
 
-  rsp = dbusif_reply_create(msg, DBUS_TYPE_INT32, &cookie, DBUS_TYPE_INVALID);
+  return cookie;
+}
 
-  server_rethink_request(1);
+/* ------------------------------------------------------------------------- *
+ * server_queue_update_event  --  replace queued event with client data
+ * ------------------------------------------------------------------------- */
 
-  log_info("%s() -> %ld\n", __FUNCTION__, (long)cookie);
+static
+cookie_t
+server_queue_update_event(alarm_event_t *event)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * remove if exists
+   * - - - - - - - - - - - - - - - - - - - */
 
-  return rsp;
+  queue_del_event(event->ALARMD_PRIVATE(cookie));
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * continue as with add
+   * - - - - - - - - - - - - - - - - - - - */
+
+  return server_queue_add_event(event);
 }
 
 /* ------------------------------------------------------------------------- *
- * server_handle_event_update  --  handle ALARMD_EVENT_UPDATE method call
+ * server_handle_event_add  --  handle ALARMD_EVENT_ADD method call
  * ------------------------------------------------------------------------- */
 
 static
 DBusMessage *
-server_handle_event_update(DBusMessage *msg)
+server_handle_event_add(DBusMessage *msg)
 {
   DBusMessage   *rsp    = 0;
   cookie_t       cookie = 0;
   alarm_event_t *event  = 0;
 
-  if( (event = dbusif_decode_event(msg)) != 0 )
+  if( (event = dbusif_decode_event_borrowed(msg)) != 0 )
   {
-    /* - - - - - - - - - - - - - - - - - - - *
-     * remove if exists
-     * - - - - - - - - - - - - - - - - - - - */
+    cookie = server_queue_add_event(event);
+  }
 
-    queue_del_event(event->ALARMD_PRIVATE(cookie));
+  rsp = dbusif_reply_create(msg, DBUS_TYPE_INT32, &cookie, DBUS_TYPE_INVALID);
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * continue as with add
-     * - - - - - - - - - - - - - - - - - - - */
+  server_rethink_request(1);
 
-    event->response = -1;
-    event->snooze_total = 0;
+  log_info("%s() -> %ld\n", __FUNCTION__, (long)cookie);
 
-    alarm_event_set_cookie(event, 0);
-    alarm_event_set_trigger(event, 0);
-    queue_event_set_state(event, ALARM_STATE_NEW);
+  return rsp;
+}
 
-    time_t trigger = server_event_evaluate_initial_trigger(event);
+/* ------------------------------------------------------------------------- *
+ * server_handle_event_update  --  handle ALARMD_EVENT_UPDATE method call
+ * ------------------------------------------------------------------------- */
 
-    time_t now = ticker_get_time();
-    if( trigger >= now )
-    {
-      alarm_event_set_trigger(event, trigger);
-      if( (cookie = queue_add_event(event)) != 0 )
-      {
-        event = 0;
-      }
-    }
-  }
+static
+DBusMessage *
+server_handle_event_update(DBusMessage *msg)
+{
+  DBusMessage   *rsp    = 0;
+  cookie_t       cookie = 0;
+  alarm_event_t *event  = 0;
 
-  alarm_event_delete(event);
+  if( (event = dbusif_decode_event_borrowed(msg)) != 0 )
+  {
+    cookie = server_queue_update_event(event);
+  }
 
   rsp = dbusif_reply_create(msg, DBUS_TYPE_INT32, &cookie, DBUS_TYPE_INVALID);
 
@@ -3247,6 +3457,108 @@ server_handle_event_del(DBusMessage *msg)
   return rsp;
 }
 
+/* ------------------------------------------------------------------------- *
+ * server_handle_events_apply  --  common code for batch add & update
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+server_handle_events_apply(DBusMessage *msg, cookie_t (*apply)(alarm_event_t *))
+{
+  DBusMessage    *rsp = 0;
+  alarm_event_t **eve = 0;
+  cookie_t       *vec = 0;
+  int             cnt = 0;
+
+  assert( sizeof(dbus_int32_t) == sizeof(cookie_t) );
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * decode everything before touching the
+   * queue -> all or nothing
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( (eve = dbusif_decode_events_borrowed(msg, &cnt)) == 0 )
+  {
+    rsp = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+                                 dbus_message_get_member(msg));
+    goto cleanup;
+  }
+
+  vec = calloc(cnt + 1, sizeof *vec);
+
+  for( int i = 0; i < cnt; ++i )
+  {
+    vec[i] = apply(eve[i]), eve[i] = 0;
+  }
+
+  rsp = dbusif_reply_create(msg,
+                            DBUS_TYPE_ARRAY, DBUS_TYPE_INT32, &vec, cnt,
+                            DBUS_TYPE_INVALID);
+
+  server_rethink_request(1);
+
+  cleanup:
+
+  log_info("%s() -> %d events\n", dbus_message_get_member(msg), cnt);
+
+  free(vec);
+  free(eve);
+
+  return rsp;
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_handle_events_add  --  handle ALARMD_EVENTS_ADD method call
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+server_handle_events_add(DBusMessage *msg)
+{
+  return server_handle_events_apply(msg, server_queue_add_event);
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_handle_events_update  --  handle ALARMD_EVENTS_UPDATE method call
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+server_handle_events_update(DBusMessage *msg)
+{
+  return server_handle_events_apply(msg, server_queue_update_event);
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_handle_events_del  -- handle ALARMD_EVENTS_DEL method call
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+server_handle_events_del(DBusMessage *msg)
+{
+  DBusMessage   *rsp    = 0;
+  dbus_int32_t  *vec    = 0;
+  int            cnt    = 0;
+  dbus_int32_t   res    = 0;
+
+  if( !(rsp = dbusif_method_parse_args(msg,
+                                       DBUS_TYPE_ARRAY, DBUS_TYPE_INT32, &vec, &cnt,
+                                       DBUS_TYPE_INVALID)) )
+  {
+    for( int i = 0; i < cnt; ++i )
+    {
+      res += queue_del_event(vec[i]);
+    }
+    rsp = dbusif_reply_create(msg, DBUS_TYPE_INT32, &res, DBUS_TYPE_INVALID);
+    server_rethink_request(1);
+  }
+
+  log_info("%s() -> %d/%d\n", __FUNCTION__, (int)res, cnt);
+
+  return rsp;
+}
+
 /* ------------------------------------------------------------------------- *
  * server_handle_event_query  --  handle ALARMD_EVENT_QUERY method call
  * ------------------------------------------------------------------------- */
@@ -3287,6 +3599,70 @@ server_handle_event_query(DBusMessage *msg)
   return rsp;
 }
 
+/* ------------------------------------------------------------------------- *
+ * server_handle_event_query_full  --  handle ALARMD_EVENT_QUERY_FULL call
+ * ------------------------------------------------------------------------- */
+
+static
+DBusMessage *
+server_handle_event_query_full(DBusMessage *msg)
+{
+  DBusMessage    *rsp  = 0;
+  dbus_int32_t    lo   = 0;
+  dbus_int32_t    hi   = 0;
+  dbus_int32_t    mask = 0;
+  dbus_int32_t    flag = 0;
+  char           *app  = 0;
+  dbus_uint32_t   offs = 0;
+  dbus_uint32_t   lim  = 0;
+  cookie_t       *vec  = 0;
+  int             cnt  = 0;
+  alarm_event_t **eve  = 0;
+  int             n    = 0;
+
+  if( !(rsp = dbusif_method_parse_args(msg,
+                                       DBUS_TYPE_INT32,  &lo,
+                                       DBUS_TYPE_INT32,  &hi,
+                                       DBUS_TYPE_INT32,  &mask,
+                                       DBUS_TYPE_INT32,  &flag,
+                                       DBUS_TYPE_STRING, &app,
+                                       DBUS_TYPE_UINT32, &offs,
+                                       DBUS_TYPE_UINT32, &lim,
+                                       DBUS_TYPE_INVALID)) )
+  {
+    if( (vec = queue_query_events(&cnt, lo, hi, mask, flag, app)) )
+    {
+      /* - - - - - - - - - - - - - - - - - - - *
+       * apply offset & limit to the matches
+       * - - - - - - - - - - - - - - - - - - - */
+
+      size_t beg = (offs < (unsigned)cnt) ? offs : (unsigned)cnt;
+      size_t end = (lim != 0 && lim < cnt - beg) ? (beg + lim) : (unsigned)cnt;
+
+      eve = calloc(end - beg + 1, sizeof *eve);
+
+      for( size_t i = beg; i < end; ++i )
+      {
+        eve[n++] = queue_get_event(vec[i]);
+      }
+
+      rsp = dbusif_reply_create(msg, DBUS_TYPE_INVALID);
+
+      if( rsp && !dbusif_encode_events(rsp, eve, n) )
+      {
+        dbus_message_unref(rsp), rsp = 0;
+      }
+    }
+  }
+
+  log_info("%s() -> %d/%d events\n", __FUNCTION__, n, cnt);
+
+  free(eve);
+  free(vec);
+
+  return rsp;
+}
+
 /* ------------------------------------------------------------------------- *
  * server_handle_event_get  --  handle ALARMD_EVENT_GET method call
  * ------------------------------------------------------------------------- */
@@ -3649,10 +4025,16 @@ server_session_bus_cb(DBusConnection *conn, DBusMessage *msg, void *user_data)
     {ALARMD_EVENT_DEL,   server_handle_event_del},
     {ALARMD_EVENT_GET,   server_handle_event_get},
     {ALARMD_EVENT_QUERY, server_handle_event_query},
+    {ALARMD_EVENT_QUERY_FULL, server_handle_event_query_full},
     {ALARMD_EVENT_UPDATE,server_handle_event_update},
 
+    {ALARMD_EVENTS_ADD,    server_handle_events_add},
+    {ALARMD_EVENTS_DEL,    server_handle_events_del},
+    {ALARMD_EVENTS_UPDATE, server_handle_events_update},
+
     {ALARMD_SNOOZE_SET,  server_handle_snooze_set},
     {ALARMD_SNOOZE_GET,  server_handle_snooze_get},
+    {ALARMD_QUEUE_STATS, server_handle_queue_stats},
 
     {ALARMD_DIALOG_RSP,  server_handle_event_ack},
     {ALARMD_DIALOG_ACK,  server_handle_queue_ack},
@@ -3725,10 +4107,16 @@ server_system_bus_cb(DBusConnection *conn, DBusMessage *msg, void *user_data)
     {ALARMD_EVENT_DEL,   server_handle_event_del},
     {ALARMD_EVENT_GET,   server_handle_event_get},
     {ALARMD_EVENT_QUERY, server_handle_event_query},
+    {ALARMD_EVENT_QUERY_FULL, server_handle_event_query_full},
     {ALARMD_EVENT_UPDATE,server_handle_event_update},
 
+    {ALARMD_EVENTS_ADD,    server_handle_events_add},
+    {ALARMD_EVENTS_DEL,    server_handle_events_del},
+    {ALARMD_EVENTS_UPDATE, server_handle_events_update},
+
     {ALARMD_SNOOZE_SET,  server_handle_snooze_set},
     {ALARMD_SNOOZE_GET,  server_handle_snooze_get},
+    {ALARMD_QUEUE_STATS, server_handle_queue_stats},
 
     {ALARMD_DIALOG_RSP,  server_handle_event_ack},
     {ALARMD_DIALOG_ACK,  server_handle_queue_ack},
@@ -3932,6 +4320,109 @@ static void server_queue_touched_ignore_setup(void)
 }
 #endif
 
+/* ========================================================================= *
+ * MERGE CHANGES MADE TO QUEUE FILE BY OTHERS
+ * ========================================================================= */
+
+#if ALARMD_QUEUE_MODIFIED_MERGE
+// io watch for the queue file directory
+static guint server_queue_watch_id = 0;
+
+/* ------------------------------------------------------------------------- *
+ * server_queue_watch_cb
+ * ------------------------------------------------------------------------- */
+
+static gboolean server_queue_watch_cb(GIOChannel *channel,
+                                      GIOCondition condition,
+                                      gpointer data)
+{
+  if( condition & ~G_IO_IN )
+  {
+    log_error("queue file watch failed\n");
+    server_queue_watch_id = 0;
+    return FALSE;
+  }
+
+  queue_handle_watch();
+  return TRUE;
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_queue_merged_cb  --  queue file changes have been merged
+ * ------------------------------------------------------------------------- */
+
+static void server_queue_merged_cb(void)
+{
+  int       cnt = 0;
+  cookie_t *vec = queue_take_replaced(&cnt);
+
+  // dismiss dialogs shown for replaced events
+  if( cnt != 0 )
+  {
+    ipc_systemui_cancel_dialog(server_system_bus, vec, cnt);
+  }
+  free(vec);
+
+  // replaced events no longer contribute to
+  // the cached wakeup and icon state
+  server_queued_valid = 0;
+
+  // evaluate added and changed events
+  server_rethink_request(0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_queue_watch_setup
+ * ------------------------------------------------------------------------- */
+
+static void server_queue_watch_setup(void)
+{
+  GIOChannel *channel = 0;
+  int         fd      = queue_get_watch_fd();
+
+  queue_set_modified_cb(server_queue_merged_cb);
+
+  if( fd == -1 )
+  {
+    goto cleanup;
+  }
+
+  if( (channel = g_io_channel_unix_new(fd)) == 0 )
+  {
+    log_error("could not create queue watch io channel\n");
+    goto cleanup;
+  }
+
+  server_queue_watch_id = g_io_add_watch(channel, G_IO_IN | G_IO_ERR | G_IO_HUP,
+                                         server_queue_watch_cb, 0);
+  if( server_queue_watch_id == 0 )
+  {
+    log_error("could not create queue watch\n");
+  }
+
+  cleanup:
+
+  if( channel != 0 )
+  {
+    g_io_channel_unref(channel);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * server_queue_watch_quit
+ * ------------------------------------------------------------------------- */
+
+static void server_queue_watch_quit(void)
+{
+  if( server_queue_watch_id != 0 )
+  {
+    g_source_remove(server_queue_watch_id);
+    server_queue_watch_id = 0;
+  }
+  queue_set_modified_cb(0);
+}
+#endif
+
 /* ========================================================================= *
  * SERVER INIT/QUIT
  * ========================================================================= */
@@ -4184,6 +4675,16 @@ server_init(void)
   server_queue_touched_ignore_setup();
 #endif
 
+#if ALARMD_QUEUE_MODIFIED_MERGE
+  server_queue_watch_setup();
+#endif
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * get notified about finished saves
+   * - - - - - - - - - - - - - - - - - - - */
+
+  queue_set_saved_cb(server_queue_saved_wakeup);
+
   /* - - - - - - - - - - - - - - - - - - - *
    * set the ball rolling
    * - - - - - - - - - - - - - - - - - - - */
@@ -4220,7 +4721,12 @@ server_quit(void)
   server_queue_touched_ignore_cancel();
 #endif
 
+#if ALARMD_QUEUE_MODIFIED_MERGE
+  server_queue_watch_quit();
+#endif
+
   server_queue_cancel_save();
+  queue_set_saved_cb(0);
 
   ipc_icd_quit();
 
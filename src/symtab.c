@@ -27,27 +27,185 @@
 #include "symtab.h"
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* hashed tables do not bother with index until they have more elements */
+#define SYMTAB_HASH_MIN 8
 
 /* ========================================================================= *
- * symtab_t  --  methods
+ * symtab_t  --  array storage
  * ========================================================================= */
 
 /* ------------------------------------------------------------------------- *
- * symtab_lookup
+ * symtab_mem_alloc  --  allocate zero filled array
  * ------------------------------------------------------------------------- */
 
+static
 void *
-symtab_lookup(symtab_t *self, const void *key)
+symtab_mem_alloc(symtab_t *self, size_t size)
+{
+  return self->st_arena ? arena_calloc(self->st_arena, size) : calloc(1, size);
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_mem_free  --  release array unless it is in arena
+ * ------------------------------------------------------------------------- */
+
+static
+void
+symtab_mem_free(symtab_t *self, void *data)
 {
-  for( int i = 0; i < self->st_count; ++i )
+  if( self->st_arena == 0 )
   {
-    void *elem = self->st_elem[i];
-    if( self->st_cmp(elem, key) )
+    free(data);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_mem_resize  --  grow array, keeping content
+ * ------------------------------------------------------------------------- */
+
+static
+void *
+symtab_mem_resize(symtab_t *self, void *data, size_t used, size_t size)
+{
+  if( self->st_arena == 0 )
+  {
+    return realloc(data, size);
+  }
+  void *res = arena_alloc(self->st_arena, size);
+  if( used != 0 )
+  {
+    memcpy(res, data, used);
+  }
+  return res;
+}
+
+/* ========================================================================= *
+ * symtab_t  --  hash index
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * symtab_hash_string  --  hash callback for tables keyed by C strings
+ * ------------------------------------------------------------------------- */
+
+size_t
+symtab_hash_string(const void *key)
+{
+  /* FNV-1a */
+  const unsigned char *str = key;
+  uint32_t             res = 2166136261u;
+
+  while( *str )
+  {
+    res ^= *str++;
+    res *= 16777619u;
+  }
+  return res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_index_put  --  add element position to hash index
+ * ------------------------------------------------------------------------- */
+
+static
+void
+symtab_index_put(symtab_t *self, size_t pos)
+{
+  size_t mask = self->st_index_size - 1;
+  size_t slot = self->st_hash(self->st_key(self->st_elem[pos])) & mask;
+
+  while( self->st_index[slot] != 0 )
+  {
+    slot = (slot + 1) & mask;
+  }
+  self->st_index[slot] = pos + 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_index_rebuild  --  rebuild hash index from element array
+ * ------------------------------------------------------------------------- */
+
+static
+void
+symtab_index_rebuild(symtab_t *self)
+{
+  symtab_mem_free(self, self->st_index);
+  self->st_index      = 0;
+  self->st_index_size = 0;
+
+  if( self->st_hash != 0 && self->st_count > SYMTAB_HASH_MIN )
+  {
+    /* keep load factor at or below 1/2 */
+    size_t size = 2 * SYMTAB_HASH_MIN;
+    while( size < 2 * self->st_count )
     {
-      return elem;
+      size *= 2;
+    }
+
+    self->st_index      = symtab_mem_alloc(self, size * sizeof *self->st_index);
+    self->st_index_size = size;
+
+    /* insertion order -> for duplicate keys the
+     * first one added is found first, as with
+     * linear lookup */
+    for( size_t i = 0; i < self->st_count; ++i )
+    {
+      symtab_index_put(self, i);
     }
   }
-  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_index_find  --  get position of element matching key, or -1
+ * ------------------------------------------------------------------------- */
+
+static
+ssize_t
+symtab_index_find(symtab_t *self, const void *key)
+{
+  if( self->st_index != 0 )
+  {
+    size_t mask = self->st_index_size - 1;
+
+    for( size_t slot = self->st_hash(key) & mask;
+         self->st_index[slot] != 0; slot = (slot + 1) & mask )
+    {
+      size_t pos = self->st_index[slot] - 1;
+
+      if( self->st_cmp(self->st_elem[pos], key) )
+      {
+        return pos;
+      }
+    }
+    return -1;
+  }
+
+  for( size_t i = 0; i < self->st_count; ++i )
+  {
+    if( self->st_cmp(self->st_elem[i], key) )
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* ========================================================================= *
+ * symtab_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * symtab_lookup
+ * ------------------------------------------------------------------------- */
+
+void *
+symtab_lookup(symtab_t *self, const void *key)
+{
+  ssize_t pos = symtab_index_find(self, key);
+  return (pos < 0) ? 0 : self->st_elem[pos];
 }
 
 /* ------------------------------------------------------------------------- *
@@ -60,12 +218,23 @@ symtab_remove(symtab_t *self, const void *key)
   size_t si = 0;
   size_t di = 0;
 
-  for( ; si < self->st_count; ++si )
+  /* nothing to do if there are no matches */
+  ssize_t pos = symtab_index_find(self, key);
+
+  if( pos < 0 )
+  {
+    return;
+  }
+
+  /* removal keeps insertion order -> positions
+   * shift and the index needs to be rebuilt */
+
+  for( si = di = pos; si < self->st_count; ++si )
   {
     void *elem = self->st_elem[si];
     if( self->st_cmp(elem, key) )
     {
-      self->st_del(elem);
+      if( self->st_del != 0 ) self->st_del(elem);
     }
     else
     {
@@ -74,6 +243,11 @@ symtab_remove(symtab_t *self, const void *key)
   }
 
   self->st_count = di;
+
+  if( self->st_index != 0 )
+  {
+    symtab_index_rebuild(self);
+  }
 }
 
 /* ------------------------------------------------------------------------- *
@@ -85,11 +259,27 @@ symtab_append(symtab_t *self, void *elem)
 {
   if( self->st_count == self->st_alloc )
   {
-    self->st_alloc += 16;
-    self->st_elem = realloc(self->st_elem,
-                            self->st_alloc * sizeof *self->st_elem);
+    /* geometric growth -> arena tables do not leave
+     * more than the final array size behind */
+    size_t alloc = self->st_alloc ? (2 * self->st_alloc) : 16;
+    self->st_elem  = symtab_mem_resize(self, self->st_elem,
+                                       self->st_alloc * sizeof *self->st_elem,
+                                       alloc * sizeof *self->st_elem);
+    self->st_alloc = alloc;
   }
   self->st_elem[self->st_count++] = elem;
+
+  if( self->st_hash != 0 )
+  {
+    if( 2 * self->st_count > self->st_index_size )
+    {
+      symtab_index_rebuild(self);
+    }
+    else
+    {
+      symtab_index_put(self, self->st_count - 1);
+    }
+  }
 }
 
 /* ------------------------------------------------------------------------- *
@@ -107,6 +297,8 @@ symtab_clear(symtab_t *self)
     }
   }
   self->st_count = 0;
+
+  symtab_index_rebuild(self);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -121,6 +313,34 @@ symtab_ctor(symtab_t *self, symtab_del_fn del, symtab_cmp_fn cmp)
   self->st_elem  = 0;
   self->st_del   = del;
   self->st_cmp   = cmp;
+  self->st_key   = 0;
+  self->st_hash  = 0;
+  self->st_index = 0;
+  self->st_index_size = 0;
+  self->st_arena = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_ctor_hashed
+ * ------------------------------------------------------------------------- */
+
+void
+symtab_ctor_hashed(symtab_t *self, symtab_del_fn del, symtab_cmp_fn cmp,
+                   symtab_key_fn key, symtab_hash_fn hash)
+{
+  symtab_ctor(self, del, cmp);
+  self->st_key  = key;
+  self->st_hash = hash;
+}
+
+/* ------------------------------------------------------------------------- *
+ * symtab_set_arena  --  take arrays from arena, call before adding elements
+ * ------------------------------------------------------------------------- */
+
+void
+symtab_set_arena(symtab_t *self, arena_t *arena)
+{
+  self->st_arena = arena;
 }
 
 /* ------------------------------------------------------------------------- *
@@ -131,7 +351,8 @@ void
 symtab_dtor(symtab_t *self)
 {
   symtab_clear(self);
-  free(self->st_elem);
+  symtab_mem_free(self, self->st_elem);
+  symtab_mem_free(self, self->st_index);
 }
 
 /* ------------------------------------------------------------------------- *
@@ -27,6 +27,8 @@
 
 #include <stddef.h>
 
+#include "arena.h"
+
 #ifdef __cplusplus
 extern "C" {
 #elif 0
@@ -35,6 +37,8 @@ extern "C" {
 
 typedef void (*symtab_del_fn)(void*);
 typedef int  (*symtab_cmp_fn)(const void *,const void *);
+typedef const void *(*symtab_key_fn)(const void *);
+typedef size_t      (*symtab_hash_fn)(const void *);
 
 typedef struct symtab_t   symtab_t;
 
@@ -42,6 +46,17 @@ typedef struct symtab_t   symtab_t;
  * symtab_t
  * ------------------------------------------------------------------------- */
 
+/* Elements are kept in insertion order in st_elem.
+ *
+ * Tables constructed with symtab_ctor_hashed() also maintain an
+ * open addressing index of element positions once they grow past
+ * a few elements, making lookups O(1) on average. The key callback
+ * must return the same key for an element for as long as it is
+ * in the table.
+ *
+ * Tables given an arena via symtab_set_arena() take their arrays
+ * from it and do not free them when destroyed. */
+
 struct symtab_t
 {
   size_t  st_count;
@@ -50,6 +65,15 @@ struct symtab_t
 
   symtab_del_fn  st_del;
   symtab_cmp_fn  st_cmp;
+
+  /* hashed lookup, optional */
+  symtab_key_fn  st_key;
+  symtab_hash_fn st_hash;
+  size_t        *st_index; // element position + 1, or 0 for empty slot
+  size_t         st_index_size;
+
+  /* array storage, optional */
+  arena_t       *st_arena;
 };
 
 void     *symtab_lookup   (symtab_t *self, const void *key);
@@ -57,6 +81,9 @@ void      symtab_remove   (symtab_t *self, const void *key);
 void      symtab_append   (symtab_t *self, void *elem);
 void      symtab_clear    (symtab_t *self);
 void      symtab_ctor     (symtab_t *self, symtab_del_fn del, symtab_cmp_fn cmp);
+void      symtab_ctor_hashed(symtab_t *self, symtab_del_fn del, symtab_cmp_fn cmp, symtab_key_fn key, symtab_hash_fn hash);
+size_t    symtab_hash_string(const void *key);
+void      symtab_set_arena(symtab_t *self, arena_t *arena);
 void      symtab_dtor     (symtab_t *self);
 symtab_t *symtab_create   (symtab_del_fn del, symtab_cmp_fn cmp);
 void      symtab_delete   (symtab_t *self);
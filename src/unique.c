@@ -28,6 +28,8 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
 
 /* ========================================================================= *
  * unique_t  --  methods
@@ -189,3 +191,202 @@ unique_add(unique_t *self, const char *str)
   self->un_string[self->un_count] = 0;
   self->un_dirty = 1;
 }
+
+/* ========================================================================= *
+ * unique pool  --  reference counted shared strings
+ * ========================================================================= */
+
+/* pooled string: bookkeeping header followed by the text */
+typedef struct
+{
+  size_t   ur_refs;
+  uint32_t ur_hash;
+  char     ur_text[];
+} unique_ref_t;
+
+/* open addressing hash table of pooled strings
+ *
+ * linear probing, table size is a power of two and kept
+ * at least twice the number of strings */
+static unique_ref_t **unique_pool_slot  = 0;
+static size_t         unique_pool_size  = 0;
+static size_t         unique_pool_count = 0;
+
+/* ------------------------------------------------------------------------- *
+ * unique_pool_hash  --  32-bit FNV-1a
+ * ------------------------------------------------------------------------- */
+
+static
+uint32_t
+unique_pool_hash(const char *str, size_t *plen)
+{
+  const unsigned char *s = (const unsigned char *)str;
+  uint32_t             h = 2166136261u;
+
+  while( *s != 0 )
+  {
+    h = (h ^ *s++) * 16777619u;
+  }
+  *plen = (const char *)s - str;
+  return h;
+}
+
+/* ------------------------------------------------------------------------- *
+ * unique_pool_resize
+ * ------------------------------------------------------------------------- */
+
+static
+void
+unique_pool_resize(size_t size)
+{
+  unique_ref_t **old = unique_pool_slot;
+  size_t         cnt = unique_pool_size;
+
+  unique_pool_slot = calloc(size, sizeof *unique_pool_slot);
+  unique_pool_size = size;
+
+  for( size_t i = 0; i < cnt; ++i )
+  {
+    if( old[i] != 0 )
+    {
+      size_t k = old[i]->ur_hash & (size - 1);
+
+      while( unique_pool_slot[k] != 0 )
+      {
+        k = (k + 1) & (size - 1);
+      }
+      unique_pool_slot[k] = old[i];
+    }
+  }
+  free(old);
+}
+
+/* ------------------------------------------------------------------------- *
+ * unique_pool_remove  --  clear table slot, see queue_hash_remove()
+ * ------------------------------------------------------------------------- */
+
+static
+void
+unique_pool_remove(size_t i)
+{
+  size_t mask = unique_pool_size - 1;
+
+  /* backward shift deletion: move entries that would
+   * become unreachable over the freed slot */
+
+  for( size_t j = i;; )
+  {
+    unique_pool_slot[i] = 0;
+
+    for( ;; )
+    {
+      j = (j + 1) & mask;
+
+      if( unique_pool_slot[j] == 0 )
+      {
+        return;
+      }
+
+      size_t k = unique_pool_slot[j]->ur_hash & mask;
+
+      if( i <= j ? (i < k && k <= j) : (i < k || k <= j) )
+      {
+        continue;
+      }
+      break;
+    }
+
+    unique_pool_slot[i] = unique_pool_slot[j];
+    i = j;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * unique_intern  --  get shared copy of string, add reference
+ * ------------------------------------------------------------------------- */
+
+char *
+unique_intern(const char *str)
+{
+  unique_ref_t *ref  = 0;
+  size_t        len  = 0;
+  uint32_t      hash = 0;
+  size_t        mask = 0;
+  size_t        i    = 0;
+
+  if( str == 0 )
+  {
+    return 0;
+  }
+
+  hash = unique_pool_hash(str, &len);
+
+  if( 2 * (unique_pool_count + 1) > unique_pool_size )
+  {
+    unique_pool_resize(unique_pool_size ? 2 * unique_pool_size : 64);
+  }
+
+  mask = unique_pool_size - 1;
+
+  for( i = hash & mask; (ref = unique_pool_slot[i]) != 0; i = (i + 1) & mask )
+  {
+    if( ref->ur_hash == hash && !strcmp(ref->ur_text, str) )
+    {
+      ref->ur_refs += 1;
+      return ref->ur_text;
+    }
+  }
+
+  ref = malloc(sizeof *ref + len + 1);
+  ref->ur_refs = 1;
+  ref->ur_hash = hash;
+  memcpy(ref->ur_text, str, len + 1);
+
+  unique_pool_slot[i] = ref;
+  unique_pool_count += 1;
+
+  return ref->ur_text;
+}
+
+/* ------------------------------------------------------------------------- *
+ * unique_release  --  drop reference to string from unique_intern()
+ * ------------------------------------------------------------------------- */
+
+void
+unique_release(char *str)
+{
+  unique_ref_t *ref  = 0;
+  size_t        mask = 0;
+  size_t        i    = 0;
+
+  if( str == 0 )
+  {
+    return;
+  }
+
+  ref = (unique_ref_t *)(str - offsetof(unique_ref_t, ur_text));
+
+  if( --ref->ur_refs != 0 )
+  {
+    return;
+  }
+
+  mask = unique_pool_size - 1;
+  i    = ref->ur_hash & mask;
+
+  while( unique_pool_slot[i] != ref )
+  {
+    i = (i + 1) & mask;
+  }
+
+  unique_pool_remove(i);
+  free(ref);
+
+  /* release the table when the last string goes */
+  if( --unique_pool_count == 0 )
+  {
+    free(unique_pool_slot);
+    unique_pool_slot = 0;
+    unique_pool_size = 0;
+  }
+}
@@ -56,6 +56,13 @@ char     **unique_final    (unique_t *self, size_t *pcount);
 char     **unique_steal    (unique_t *self, size_t *pcount);
 void       unique_add      (unique_t *self, const char *str);
 
+/* ------------------------------------------------------------------------- *
+ * unique pool
+ * ------------------------------------------------------------------------- */
+
+char      *unique_intern   (const char *str);
+void       unique_release  (char *str);
+
 #ifdef __cplusplus
 };
 #endif
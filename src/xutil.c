@@ -149,6 +149,48 @@ xsavefile(const char *path, int mode, const void *data, size_t size)
   return err;
 }
 
+/* ------------------------------------------------------------------------- *
+ * xappendfile  --  append buffer to file
+ * ------------------------------------------------------------------------- */
+
+int
+xappendfile(const char *path, int mode, const void *data, size_t size)
+{
+  int     err  = -1;
+  int     file = -1;
+
+  if( (file = open(path, O_WRONLY|O_CREAT|O_APPEND, mode)) == -1 )
+  {
+    log_error_F("%s: open: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  errno = 0;
+  if( write(file, data, size) != size )
+  {
+    log_error_F("%s: write: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  if( fsync(file) == -1 )
+  {
+    log_error_F("%s: sync: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  err = 0;
+
+  cleanup:
+
+  if( file != -1 && close(file) == -1 )
+  {
+    log_error_F("%s: close: %s\n", path, strerror(errno));
+    err = -1;
+  }
+
+  return err;
+}
+
 /* ------------------------------------------------------------------------- *
  * xcyclefiles  --  rename: temp -> current -> backup
  * ------------------------------------------------------------------------- */
@@ -244,3 +286,35 @@ xcheckstats(const char *path, const struct stat *old)
 
   return ok;
 }
+
+/* ------------------------------------------------------------------------- *
+ * xcrc32  --  update crc-32 (ieee 802.3) checksum
+ * ------------------------------------------------------------------------- */
+
+uint32_t
+xcrc32(uint32_t crc, const void *data, size_t size)
+{
+  static uint32_t lut[256];
+
+  const unsigned char *pos = data;
+
+  if( lut[1] == 0 )
+  {
+    for( uint32_t i = 0; i < 256; ++i )
+    {
+      uint32_t c = i;
+      for( int k = 0; k < 8; ++k )
+      {
+        c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+      }
+      lut[i] = c;
+    }
+  }
+
+  crc = ~crc;
+  while( size-- )
+  {
+    crc = lut[(crc ^ *pos++) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
@@ -27,6 +27,7 @@
 
 # include <sys/types.h>
 # include <sys/stat.h>
+# include <stdint.h>
 
 # include <string.h>
 # include <stdlib.h>
@@ -45,9 +46,11 @@ int  xscratchbox(void);
 int  xexists(const char *path);
 int  xloadfile(const char *path, char **pdata, size_t *psize);
 int  xsavefile(const char *path, int mode, const void *data, size_t size);
+int  xappendfile(const char *path, int mode, const void *data, size_t size);
 int  xcyclefiles(const char *temp, const char *path, const char *back);
 void xfetchstats(const char *path, struct stat *cur);
 int  xcheckstats(const char *path, const struct stat *old);
+uint32_t xcrc32(uint32_t crc, const void *data, size_t size);
 
 /* ========================================================================= *
  * INLINE FUNCTIONS
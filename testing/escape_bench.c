@@ -0,0 +1,247 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+/* Compares escape.c encode / decode against the original byte at
+ * a time loops using lines from a queue file:
+ *
+ *   escape_bench [/var/cache/alarmd/alarm_queue.ini] [rounds]
+ */
+
+#include "../src/escape.c"
+
+#include <time.h>
+
+/* ========================================================================= *
+ * byte at a time reference implementation
+ * ========================================================================= */
+
+static size_t
+ref_encode(char *dst, const char *src)
+{
+  char *pos = dst;
+
+  for( ; *src; ++src )
+  {
+    int c = *src;
+
+    if( !esc_p(c) )
+    {
+      *pos++ = c;
+      continue;
+    }
+
+    *pos++ = '\\';
+
+    switch( c )
+    {
+    case '\\': *pos++ = '\\'; break;
+    case '\b': *pos++ = 'b';  break;
+    case '\n': *pos++ = 'n';  break;
+    case '\r': *pos++ = 'r';  break;
+    case '\t': *pos++ = 't';  break;
+    default:
+      *pos++ = 'x';
+      *pos++ = itoc((c >> 4)&15);
+      *pos++ = itoc((c >> 0)&15);
+      break;
+    }
+  }
+
+  *pos = 0;
+  return pos - dst;
+}
+
+static char *
+ref_decode(char *dst, const char *src, const char *end)
+{
+  int n,l,h;
+
+  while( src < end && (n = *src++) != 0 )
+  {
+    if( n != '\\' )
+    {
+      *dst++ = n;
+      continue;
+    }
+
+    switch( (n = (src < end) ? *src++ : 0) )
+    {
+    case '\\': *dst++ = '\\'; break;
+    case 'b':  *dst++ = '\b'; break;
+    case 'n':  *dst++ = '\n'; break;
+    case 'r':  *dst++ = '\r'; break;
+    case 't':  *dst++ = '\t'; break;
+
+    case 'x':
+      if( src >= end || (h = ctoi(*src++)) == -1 ) return 0;
+      if( src >= end || (l = ctoi(*src++)) == -1 ) return 0;
+      *dst++ = (h << 4) | (l << 0);
+      break;
+
+    default:
+      return 0;
+    }
+  }
+
+  *dst = 0;
+  return dst;
+}
+
+/* ========================================================================= *
+ * benchmark
+ * ========================================================================= */
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int
+main(int ac, char **av)
+{
+  const char *path   = (ac > 1) ? av[1] : "/var/cache/alarmd/alarm_queue.ini";
+  int         rounds = (ac > 2) ? atoi(av[2]) : 200;
+
+  FILE   *file = 0;
+  char  **raw  = 0;   // decoded lines
+  char  **esc  = 0;   // encoded lines
+  size_t  cnt  = 0;
+  size_t  bytes = 0;
+  char   *buff = 0;
+  size_t  size = 0;
+  char   *tmp  = 0;
+  size_t  tmax = 0;
+  int     err  = EXIT_FAILURE;
+
+  if( (file = fopen(path, "r")) == 0 )
+  {
+    perror(path);
+    goto cleanup;
+  }
+
+  for( size_t alloc = 0; escape_getline(file, &buff, &size) == 0; ++cnt )
+  {
+    if( cnt == alloc )
+    {
+      alloc = alloc ? 2 * alloc : 256;
+      raw = realloc(raw, alloc * sizeof *raw);
+      esc = realloc(esc, alloc * sizeof *esc);
+    }
+    raw[cnt] = strdup(buff);
+    esc[cnt] = malloc(4 * strlen(buff) + 1);
+    escape_encode(esc[cnt], raw[cnt]);
+    bytes += strlen(esc[cnt]) + 1;
+
+    if( tmax < 4 * strlen(buff) + 1 ) tmax = 4 * strlen(buff) + 1;
+  }
+
+  if( cnt == 0 )
+  {
+    fprintf(stderr, "%s: no lines\n", path);
+    goto cleanup;
+  }
+
+  tmp = malloc(tmax);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * both versions must produce same output
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < cnt; ++i )
+  {
+    char   ref[4 * strlen(raw[i]) + 1];
+    size_t n = ref_encode(ref, raw[i]);
+
+    if( n != strlen(esc[i]) || strcmp(ref, esc[i]) )
+    {
+      fprintf(stderr, "line %zu: encode mismatch\n", i + 1);
+      goto cleanup;
+    }
+    if( !ref_decode(ref, esc[i], esc[i] + n) || strcmp(ref, raw[i]) ||
+        !escape_decode(tmp, esc[i], esc[i] + n) || strcmp(tmp, raw[i]) )
+    {
+      fprintf(stderr, "line %zu: decode mismatch\n", i + 1);
+      goto cleanup;
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * timing
+   * - - - - - - - - - - - - - - - - - - - */
+
+  auto void bench(const char *name, int encode, int fast);
+
+  auto void bench(const char *name, int encode, int fast)
+  {
+    double t = now();
+
+    for( int r = 0; r < rounds; ++r )
+    {
+      for( size_t i = 0; i < cnt; ++i )
+      {
+        if( encode )
+        {
+          fast ? escape_encode(tmp, raw[i]) : ref_encode(tmp, raw[i]);
+        }
+        else
+        {
+          const char *end = esc[i] + strlen(esc[i]);
+          fast ? escape_decode(tmp, esc[i], end) : ref_decode(tmp, esc[i], end);
+        }
+      }
+    }
+
+    t = now() - t;
+    printf("%-12s %8.3f ms  %8.1f MB/s\n", name, t * 1e3,
+           bytes * (double)rounds / t / (1 << 20));
+  }
+
+  printf("%s: %zu lines, %zu bytes, %d rounds\n", path, cnt, bytes, rounds);
+
+  bench("encode/byte", 1, 0);
+  bench("encode/word", 1, 1);
+  bench("decode/byte", 0, 0);
+  bench("decode/word", 0, 1);
+
+  err = EXIT_SUCCESS;
+
+  cleanup:
+
+  for( size_t i = 0; i < cnt; ++i )
+  {
+    free(raw[i]);
+    free(esc[i]);
+  }
+  free(raw);
+  free(esc);
+  free(buff);
+  free(tmp);
+
+  if( file != 0 ) fclose(file);
+
+  return err;
+}
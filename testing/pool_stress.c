@@ -0,0 +1,154 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+/* Churns events through alarm_event_create() / alarm_event_delete()
+ * the way the server does for add / update / delete requests, once
+ * with plain heap allocations and once with the object pools:
+ *
+ *   pool_stress [rounds] [live events]
+ */
+
+#include "../src/libalarm.h"
+#include "../src/pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* ========================================================================= *
+ * workload
+ * ========================================================================= */
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static alarm_event_t *
+make_event(unsigned seed)
+{
+  alarm_event_t *eve = alarm_event_create();
+
+  alarm_event_add_actions(eve, 1 + seed % 3);
+
+  if( seed & 4 )
+  {
+    alarm_event_add_recurrences(eve, 1);
+  }
+
+  alarm_event_set_attr_int(eve, "seed", seed);
+  alarm_event_set_attr_string(eve, "kind", "stress");
+
+  if( seed & 8 )
+  {
+    alarm_event_set_attr_time(eve, "when", seed);
+  }
+  return eve;
+}
+
+static double
+run(int rounds, size_t live)
+{
+  alarm_event_t **vec = calloc(live, sizeof *vec);
+  double          t   = now();
+
+  srand(1);
+
+  for( int r = 0; r < rounds; ++r )
+  {
+    size_t i = rand() % live;
+
+    alarm_event_delete(vec[i]);
+    vec[i] = make_event(rand());
+  }
+
+  for( size_t i = 0; i < live; ++i )
+  {
+    alarm_event_delete(vec[i]);
+  }
+  free(vec);
+
+  return now() - t;
+}
+
+/* ========================================================================= *
+ * main
+ * ========================================================================= */
+
+int
+main(int ac, char **av)
+{
+  int    rounds = (ac > 1) ? atoi(av[1]) : 1000000;
+  size_t live   = (ac > 2) ? strtoul(av[2], 0, 0) : 500;
+
+  unsigned long hits   = 0;
+  unsigned long misses = 0;
+
+  pool_t *all[] =
+  {
+    &pool_event, &pool_attr,
+    &pool_action[0], &pool_action[1], &pool_action[2], &pool_action[3],
+    &pool_recur[0],  &pool_recur[1],  &pool_recur[2],  &pool_recur[3],
+  };
+
+  if( rounds <= 0 || live == 0 )
+  {
+    fprintf(stderr, "usage: pool_stress [rounds] [live events]\n");
+    return EXIT_FAILURE;
+  }
+
+  double heap = run(rounds, live);
+
+  pool_enable(POOL_LIMIT_DEFAULT);
+  double pool = run(rounds, live);
+
+  for( size_t i = 0; i < sizeof all / sizeof *all; ++i )
+  {
+    const pool_t *p = all[i];
+
+    if( p->po_hits + p->po_misses == 0 )
+    {
+      continue;
+    }
+
+    printf("%-8s %10lu hits %10lu misses %10lu drops %4zu cached\n",
+           p->po_name, p->po_hits, p->po_misses, p->po_drops, p->po_cached);
+
+    hits   += p->po_hits;
+    misses += p->po_misses;
+  }
+
+  pool_disable();
+
+  printf("%d rounds, %zu live events\n", rounds, live);
+  printf("heap: %8.3f ms  %10lu object allocations\n",
+         heap * 1e3, hits + misses);
+  printf("pool: %8.3f ms  %10lu object allocations (%.1f%%)\n",
+         pool * 1e3, misses, 100.0 * misses / (hits + misses));
+
+  return (hits > misses) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,451 @@
+/* ========================================================================= *
+ *
+ * This file is part of Alarmd
+ *
+ * Copyright (C) 2008-2009 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Simo Piiroinen <simo.piiroinen@nokia.com>
+ *
+ * Alarmd is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * Alarmd is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Alarmd; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * ========================================================================= */
+
+/* Compares the closed form recurrence solver against the original
+ * step by step implementation using random masks and start times:
+ *
+ *   recur_diff [cases] [seed]
+ *
+ * Without a seed, seeds 1 to 10 are run with the given number of
+ * cases each.
+ *
+ * The expected wall clock time is what the original code gives in
+ * UTC. In zones with daylight saving time the result must be that
+ * time resolved as documented for alarm_recur_handle_masks(). The
+ * original code follows mktime() at every step there, so it is
+ * compared directly only in zones without daylight saving time.
+ */
+
+#include "../src/recurrence.c"
+
+#include <stdio.h>
+#include <string.h>
+
+/* zones with whole hour, half hour, negative and no daylight saving
+ * time changes; the original code can loop forever in the spring gap
+ * of negative daylight saving time, so it is not run in Dublin */
+static const struct
+{
+  const char *name;
+  int         dst;
+  int         step;
+} zones[] =
+{
+  { "UTC",                 0, 1 },
+  { "EET",                 1, 1 },
+  { "Europe/Helsinki",     1, 1 },
+  { "Europe/Dublin",       1, 0 },
+  { "America/New_York",    1, 1 },
+  { "Australia/Lord_Howe", 1, 1 },
+  { "Asia/Kolkata",        0, 1 },
+};
+
+#define ZONE_CNT (sizeof zones / sizeof *zones)
+
+/* ========================================================================= *
+ * random input
+ * ========================================================================= */
+
+static uint32_t
+rnd_bits(int bits, int sparse)
+{
+  uint32_t res = 0;
+
+  for( int i = 0; i < bits; ++i )
+  {
+    if( rand() % sparse == 0 ) res |= 1u << i;
+  }
+  return res;
+}
+
+static void
+rnd_recur(alarm_recur_t *rec)
+{
+  alarm_recur_ctor(rec);
+
+  switch( rand() % 4 )
+  {
+  case 0: break;
+  case 1: rec->mask_min = 1ull << (rand() % 60); break;
+  default:
+    rec->mask_min = rnd_bits(30, 8) | ((uint64_t)rnd_bits(30, 8) << 30);
+    break;
+  }
+
+  if( rand() % 3 ) rec->mask_hour = rnd_bits(24, 1 + rand() % 12);
+  if( rand() % 2 ) rec->mask_wday = rnd_bits(7, 1 + rand() % 4);
+  if( rand() % 3 ) rec->mask_mon  = rnd_bits(12, 1 + rand() % 6);
+
+  if( rand() % 2 )
+  {
+    /* always include a day that exists in every month,
+     * otherwise the reference could search forever */
+    rec->mask_mday = rnd_bits(32, 1 + rand() % 16) & ALARM_RECUR_MDAY_ALL;
+    rec->mask_mday |= (rand() % 3) ? (1u << (1 + rand() % 28))
+                                   : ALARM_RECUR_MDAY_EOM;
+  }
+}
+
+static void
+rnd_start(struct tm *tm, const char *tz)
+{
+  time_t t = 946684800 + (time_t)(rand() % 1000) * 86400 * 10 +
+             rand() % 86400;
+
+  if( rand() % 4 == 0 ) t -= t % 60;
+
+  ticker_get_local_ex(t, tm);
+
+  /* move the time to the local time of the zone */
+  tm->tm_isdst = -1;
+  ticker_build_tm(tm, tz);
+}
+
+/* ========================================================================= *
+ * reference
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * step_masks  --  the original implementation, step by step
+ * ------------------------------------------------------------------------- */
+
+/* Every step is normalized with mktime(). In a zone without daylight
+ * saving time this gives the wall clock result the solver should. */
+
+static
+time_t
+step_masks(const alarm_recur_t *self, struct tm *dst,
+           const char *tz, int align_only)
+{
+  time_t    res = -1;
+  int       inc = (align_only == 0);
+
+  /* Hours, minutes and seconds behave logically and
+   * can thus be handled separately */
+
+  // SECONDS
+  if( dst->tm_sec != 0 )
+  {
+    inc = 0, dst->tm_min += 1, dst->tm_sec = 0;
+    if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
+    {
+      goto cleanup;
+    }
+    //log_debug("SECS: %s\n", ticker_date_format_long(0,0,res));
+  }
+
+  // MINUTES
+  if( self->mask_min & ALARM_RECUR_MIN_ALL )
+  {
+    for( dst->tm_min += inc, inc = 0; ; dst->tm_min += 1 )
+    {
+      if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
+      {
+        goto cleanup;
+      }
+      if( (self->mask_min & (1llu<<dst->tm_min)) )
+      {
+        break;
+      }
+    }
+    //log_debug("MINS: %s\n", ticker_date_format_long(0,0,res));
+  }
+
+  // HOURS
+  if( self->mask_hour & ALARM_RECUR_HOUR_ALL )
+  {
+    for( dst->tm_hour += inc, inc = 0; ; dst->tm_hour += 1 )
+    {
+      if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
+      {
+        goto cleanup;
+      }
+      if( (self->mask_hour & (1u<<dst->tm_hour)) )
+      {
+        break;
+      }
+    }
+    //log_debug("HOUR: %s\n", ticker_date_format_long(0,0,res));
+  }
+
+  /* Month, day of month and day of week do not progress
+   * linearly and thus must be handled all at once */
+
+  // DAY OF MONTH and DAY OF WEEK and MONTH
+
+  uint32_t M_wday = self->mask_wday & ALARM_RECUR_WDAY_ALL;
+  uint32_t M_mday = self->mask_mday & ALARM_RECUR_MDAY_ALL;
+  uint32_t M_eom  = self->mask_mday & ALARM_RECUR_MDAY_EOM;
+  uint32_t M_mon  = self->mask_mon  & ALARM_RECUR_MON_ALL;
+
+  if( M_wday || M_mday || M_eom || M_mon )
+  {
+    if( M_wday == 0 )
+    {
+      M_wday = ALARM_RECUR_WDAY_ALL;
+    }
+    if( M_mday == 0 && M_eom == 0 )
+    {
+      M_mday = ALARM_RECUR_MDAY_ALL;
+    }
+    if( M_mon == 0 )
+    {
+      M_mon = ALARM_RECUR_MON_ALL;
+    }
+
+    for( dst->tm_mday += inc, inc = 0;; )
+    {
+      if( (res = ticker_build_tm_guess_dst(dst, tz)) == -1 )
+      {
+        goto cleanup;
+      }
+
+      if( !(M_mon & (1u << dst->tm_mon)) )
+      {
+        inc = 0, dst->tm_mon += 1, dst->tm_mday = 1;
+        continue;
+      }
+
+      uint32_t T_mday = M_mday;
+
+      if( M_eom )
+      {
+        T_mday |= (1u << ticker_get_days_in_month(dst));
+      }
+
+      if( (M_wday & (1<<dst->tm_wday)) && (T_mday & (1<<dst->tm_mday)) )
+      {
+        break;
+      }
+      inc = 0, dst->tm_mday += 1;
+    }
+    //log_debug("DATE: %s\n", ticker_date_format_long(0,0,res));
+  }
+
+  cleanup:
+
+  return res;
+}
+
+/* ========================================================================= *
+ * main
+ * ========================================================================= */
+
+static int
+same_tm(const struct tm *a, const struct tm *b)
+{
+  return (alarm_recur_compare_time(a, b) == 0 && a->tm_wday == b->tm_wday);
+}
+
+/* Checks the solver result against the wall clock result. Returns
+ * NULL if it is as expected, otherwise what is wrong. */
+
+static const char *
+check_result(const alarm_recur_t *rec, const struct tm *beg,
+             const struct tm *wall, time_t t_wall,
+             const struct tm *res, time_t t_res,
+             const char *tz, int align, int *gaps)
+{
+  struct tm tmp;
+  time_t    t0, t;
+  time_t    first = -1;
+  int       exists = 0;
+
+  if( (t_wall == -1) != (t_res == -1) )
+  {
+    return "match / no match differs";
+  }
+  if( t_res == -1 )
+  {
+    return NULL;
+  }
+
+  tmp = *res;
+  if( ticker_build_tm(&tmp, tz) != t_res || !same_tm(&tmp, res) )
+  {
+    return "result is not a valid local time";
+  }
+
+  tmp = *beg;
+  t0  = ticker_build_tm(&tmp, tz);
+  if( t_res < t0 || (t_res == t0 && !align) )
+  {
+    return "result is not after the start";
+  }
+
+  /* earliest occurrence of the wall clock time after the start */
+  for( int isdst = 1; isdst >= 0; --isdst )
+  {
+    tmp = *wall;
+    tmp.tm_isdst = isdst;
+    t = ticker_build_tm(&tmp, tz);
+
+    if( alarm_recur_compare_time(&tmp, wall) != 0 )
+    {
+      continue;
+    }
+    exists = 1;
+    if( (t > t0 || (align && t == t0)) && (first == -1 || t < first) )
+    {
+      first = t;
+    }
+  }
+
+  if( first != -1 )
+  {
+    if( t_res != first || !same_tm(res, wall) )
+    {
+      return "does not resolve the wall clock time";
+    }
+    return NULL;
+  }
+
+  if( exists )
+  {
+    return "wall clock time only before the start";
+  }
+
+  /* in a daylight saving time gap, the result must be a later
+   * time that is allowed by the masks */
+  *gaps += 1;
+
+  tmp = *res;
+  if( alarm_recur_compare_time(res, wall) <= 0 ||
+      step_masks(rec, &tmp, "UTC", 1) == -1 || !same_tm(&tmp, res) )
+  {
+    return "bad result after a daylight saving time gap";
+  }
+
+  return NULL;
+}
+
+static
+int
+run_seed(int seed, int cases, double *t_step, double *t_solve,
+         int *changed, int *gaps)
+{
+  int fails = 0;
+
+  srand(seed);
+
+  for( int i = 0; i < cases; ++i )
+  {
+    int           zone  = rand() % ZONE_CNT;
+    const char   *tz    = zones[zone].name;
+    int           align = rand() % 2;
+    alarm_recur_t rec;
+    struct tm     beg, ref, res, wall;
+    clock_t       c0, c1, c2;
+    const char   *err   = NULL;
+
+    rnd_recur(&rec);
+    rnd_start(&beg, tz);
+
+    ref = res = wall = beg;
+
+    if( !zones[zone].step )
+    {
+      time_t t_res  = alarm_recur_handle_masks(&rec, &res, tz, align);
+      time_t t_wall = step_masks(&rec, &wall, "UTC", align);
+
+      err = check_result(&rec, &beg, &wall, t_wall, &res, t_res,
+                         tz, align, gaps);
+      goto report;
+    }
+
+    c0 = clock();
+    time_t t_ref = step_masks(&rec, &ref, tz, align);
+    c1 = clock();
+    time_t t_res = alarm_recur_handle_masks(&rec, &res, tz, align);
+    c2 = clock();
+
+    *t_step  += c1 - c0;
+    *t_solve += c2 - c1;
+
+    time_t t_wall = step_masks(&rec, &wall, "UTC", align);
+
+    if( t_ref != t_res || (t_ref != -1 && !same_tm(&ref, &res)) )
+    {
+      if( !zones[zone].dst )
+      {
+        err = "differs from the original code";
+      }
+      *changed += 1;
+    }
+
+    if( !err )
+    {
+      err = check_result(&rec, &beg, &wall, t_wall, &res, t_res,
+                         tz, align, gaps);
+    }
+
+    report:
+
+    if( err )
+    {
+      if( ++fails <= 10 )
+      {
+        printf("seed %d, case %d, %s, align=%d: %s\n", seed, i, tz, align,
+               err);
+        printf("  masks: min=%llx hour=%x mday=%x wday=%x mon=%x\n",
+               (unsigned long long)rec.mask_min, rec.mask_hour,
+               rec.mask_mday, rec.mask_wday, rec.mask_mon);
+        printf("  start: %s", asctime(&beg));
+        printf("  step:  %s", asctime(&ref));
+        printf("  wall:  %s", asctime(&wall));
+        printf("  solve: %s", asctime(&res));
+      }
+    }
+  }
+
+  return fails;
+}
+
+int
+main(int ac, char **av)
+{
+  int cases = (ac > 1) ? atoi(av[1]) : 20000;
+  int lo    = (ac > 2) ? atoi(av[2]) : 1;
+  int hi    = (ac > 2) ? lo : 10;
+  int fails = 0;
+  int changed = 0;
+  int gaps    = 0;
+
+  double t_step  = 0;
+  double t_solve = 0;
+
+  for( int seed = lo; seed <= hi; ++seed )
+  {
+    fails += run_seed(seed, cases, &t_step, &t_solve, &changed, &gaps);
+  }
+
+  printf("%d seeds, %d cases each, %d failures\n", hi - lo + 1, cases,
+         fails);
+  printf("%d differ from the original code, %d hit a gap\n", changed,
+         gaps);
+  printf("step:  %8.3f ms\n", t_step  * 1e3 / CLOCKS_PER_SEC);
+  printf("solve: %8.3f ms\n", t_solve * 1e3 / CLOCKS_PER_SEC);
+
+  return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}